@@ -43,21 +43,32 @@ extern "C" {
 #include "librfn/bitops.h"
 #include "librfn/console.h"
 #include "librfn/constexpr.h"
+#include "librfn/dlist.h"
+#include "librfn/elemring.h"
 #include "librfn/enum.h"
 #include "librfn/fibre.h"
+#include "librfn/fibresync.h"
 #include "librfn/fixed.h"
 #include "librfn/fuzz.h"
+#include "librfn/heap.h"
 #include "librfn/hex.h"
+#include "librfn/lfstack.h"
 #include "librfn/list.h"
 #include "librfn/messageq.h"
 #include "librfn/mlog.h"
+#include "librfn/mpmcq.h"
+#include "librfn/mpscq.h"
 #include "librfn/pack.h"
 #include "librfn/protothreads.h"
 #include "librfn/rand.h"
+#include "librfn/rbtree.h"
+#include "librfn/recordq.h"
 #include "librfn/regdump.h"
 #include "librfn/rgb.h"
 #include "librfn/ringbuf.h"
 #include "librfn/rotenc.h"
+#include "librfn/spscring.h"
+#include "librfn/stackfibre.h"
 #include "librfn/stats.h"
 #include "librfn/string.h"
 #include "librfn/time.h"
@@ -138,4 +138,14 @@ typedef unsigned int atomic_uint __attribute__((aligned(SIZEOF_ATOMIC_UINT)));
 
 #endif /* __STDC_NO_ATOMICS__ */
 
+/*!
+ * \brief Alignment used to keep independently updated atomics apart.
+ *
+ * Variables written by different CPUs should not share a cache line
+ * otherwise every update steals the line from the other CPU.
+ */
+#ifndef CONFIG_CACHE_LINE_SIZE
+#define CONFIG_CACHE_LINE_SIZE 64
+#endif
+
 #endif // RF_ATOMIC_H_
@@ -49,6 +49,11 @@ typedef struct bintree_iterator {
 	bintree_is_list_t *filter;
 	bintree_node_t *curr;
 	bintree_node_t *parent; // only valid for post-order iteration
+
+	// only used by the stack based iterators
+	bintree_node_t **stack;
+	unsigned int depth;
+	unsigned int max_depth;
 } bintree_iterator_t;
 
 static inline bool bintree_is_leaf(bintree_node_t *tree)
@@ -102,6 +107,47 @@ bintree_node_t *bintree_iterate_post_order(bintree_iterator_t *iter,
 bintree_node_t *bintree_iterate_pre_order(bintree_iterator_t *iter,
 					  bintree_node_t *tree);
 
+/*!
+ * \brief Iterate in-order without modifying the tree.
+ *
+ * The iterate functions above thread the tree as they go. This makes them
+ * allocation free but means the tree cannot be examined by anyone else
+ * until the iteration is complete. The stack based iterators instead
+ * record the path to the current node in a caller supplied array. They
+ * never modify the tree so any number of them may be run concurrently
+ * and an iteration may be abandoned at any point.
+ *
+ * max_depth is the number of elements in stack and must be at least the
+ * height of the tree (a tree containing only a root node has a height of
+ * one).
+ */
+bintree_node_t *bintree_iterate_in_order_stack(bintree_iterator_t *iter,
+					       bintree_node_t *tree,
+					       bintree_node_t **stack,
+					       unsigned int max_depth);
+
+/*!
+ * \brief Iterate in post-order without modifying the tree.
+ *
+ * See bintree_iterate_in_order_stack(). As with
+ * bintree_iterate_post_order() it is safe to free each node as it is
+ * visited and iter->parent identifies the parent of the current node.
+ */
+bintree_node_t *bintree_iterate_post_order_stack(bintree_iterator_t *iter,
+						 bintree_node_t *tree,
+						 bintree_node_t **stack,
+						 unsigned int max_depth);
+
+/*!
+ * \brief Iterate in pre-order without modifying the tree.
+ *
+ * See bintree_iterate_in_order_stack().
+ */
+bintree_node_t *bintree_iterate_pre_order_stack(bintree_iterator_t *iter,
+						bintree_node_t *tree,
+						bintree_node_t **stack,
+						unsigned int max_depth);
+
 static inline bintree_node_t *bintree_next(bintree_iterator_t *iter)
 {
 	return iter->next(iter);
@@ -109,6 +155,13 @@ static inline bintree_node_t *bintree_next(bintree_iterator_t *iter)
 
 static inline void bintree_iterate_complete(bintree_iterator_t *iter)
 {
+	/* stack based iterators have no modifications to undo */
+	if (iter->stack) {
+		iter->depth = 0;
+		iter->curr = NULL;
+		return;
+	}
+
 	while (bintree_next(iter))
 		;
 }
@@ -148,6 +201,30 @@ static inline void bintree_iterate_complete(bintree_iterator_t *iter)
 		    bintree_iterate_pre_order(iter, to_bintree(tree)));        \
 	}                                                                      \
                                                                                \
+	static inline type *prefix##_iterate_in_order_stack(                   \
+	    bintree_iterator_t *iter, type *tree, bintree_node_t **stack,      \
+	    unsigned int max_depth)                                            \
+	{                                                                      \
+		return from_bintree(bintree_iterate_in_order_stack(            \
+		    iter, to_bintree(tree), stack, max_depth));                \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_iterate_post_order_stack(                 \
+	    bintree_iterator_t *iter, type *tree, bintree_node_t **stack,      \
+	    unsigned int max_depth)                                            \
+	{                                                                      \
+		return from_bintree(bintree_iterate_post_order_stack(          \
+		    iter, to_bintree(tree), stack, max_depth));                \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_iterate_pre_order_stack(                  \
+	    bintree_iterator_t *iter, type *tree, bintree_node_t **stack,      \
+	    unsigned int max_depth)                                            \
+	{                                                                      \
+		return from_bintree(bintree_iterate_pre_order_stack(           \
+		    iter, to_bintree(tree), stack, max_depth));                \
+	}                                                                      \
+                                                                               \
 	static inline type *prefix##_next(bintree_iterator_t *iter)            \
 	{                                                                      \
 		return from_bintree(bintree_next(iter));                       \
@@ -0,0 +1,133 @@
+/*
+ * dlist.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_DLIST_H_
+#define RF_DLIST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * \defgroup librfn_dlist Doubly linked list
+ *
+ * \brief A doubly linked list with constant time removal and splicing.
+ *
+ * The list nodes are intended to be embedded within other structures and
+ * recovered using containerof(). Unlike the \ref librfn_list "singly linked
+ * list" a node can be removed without searching for it, at the cost of
+ * an extra pointer per node. As with the singly linked list a zero
+ * initialized list (or node) is valid and empty.
+ *
+ * No form of internal locking or other thread-safety is provided.
+ *
+ * @{
+ */
+
+typedef struct dlist_node {
+	struct dlist_node *next;
+	struct dlist_node *prev;
+} dlist_node_t;
+#define DLIST_NODE_VAR_INIT { 0 }
+
+typedef struct {
+	dlist_node_t *head;
+	dlist_node_t *tail;
+} dlist_t;
+#define DLIST_VAR_INIT { 0 }
+
+/*
+ * insertion operations
+ */
+
+/*! \brief Insert a node at the tail of the list. */
+void dlist_insert(dlist_t *list, dlist_node_t *node);
+
+/*! \brief Insert a node at the head of the list. */
+void dlist_push(dlist_t *list, dlist_node_t *node);
+
+/*! \brief Insert a node immediately before pos (which must be in the list). */
+void dlist_insert_before(dlist_t *list, dlist_node_t *pos,
+			 dlist_node_t *node);
+
+/*! \brief Insert a node immediately after pos (which must be in the list). */
+void dlist_insert_after(dlist_t *list, dlist_node_t *pos, dlist_node_t *node);
+
+/*!
+ * \brief Move every node from src to the tail of list.
+ *
+ * src is left empty.
+ */
+void dlist_splice(dlist_t *list, dlist_t *src);
+
+/*
+ * extraction operations
+ */
+
+/*! \brief Remove and return the head of the list (or NULL if empty). */
+dlist_node_t *dlist_extract(dlist_t *list);
+
+/*! \brief Remove and return the tail of the list (or NULL if empty). */
+dlist_node_t *dlist_extract_tail(dlist_t *list);
+
+/*!
+ * \brief Remove a node from the list.
+ *
+ * The node must be a member of the list.
+ */
+void dlist_remove(dlist_t *list, dlist_node_t *node);
+
+/*
+ * search operations
+ */
+
+static inline bool dlist_empty(dlist_t *list)
+{
+	return !list->head;
+}
+
+static inline dlist_node_t *dlist_peek(dlist_t *list)
+{
+	return list->head;
+}
+
+static inline dlist_node_t *dlist_peek_tail(dlist_t *list)
+{
+	return list->tail;
+}
+
+bool dlist_contains(dlist_t *list, dlist_node_t *node);
+
+/*
+ * list traversal
+ */
+
+/*!
+ * \brief Iterate over a list from head to tail.
+ *
+ * It is safe to remove node from the list within the loop body.
+ */
+#define dlist_foreach(list, node, tmp)                                         \
+	for ((node) = (list)->head; (node) && ((tmp) = (node)->next, true);    \
+	     (node) = (tmp))
+
+/*!
+ * \brief Iterate over a list from tail to head.
+ *
+ * It is safe to remove node from the list within the loop body.
+ */
+#define dlist_foreach_reverse(list, node, tmp)                                 \
+	for ((node) = (list)->tail; (node) && ((tmp) = (node)->prev, true);    \
+	     (node) = (tmp))
+
+/*! @} */
+#endif // RF_DLIST_H_
@@ -0,0 +1,142 @@
+/*
+ * elemring.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_ELEMRING_H_
+#define RF_ELEMRING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+/*!
+ * \defgroup librfn_elemring Element ring buffer
+ *
+ * \brief Lockless ring buffer of fixed size elements.
+ *
+ * This is the \ref librfn_ringbuf "ring buffer" generalized to elements of
+ * any size, such as audio samples or sensor records. Elements are copied
+ * in and out of the ring, either singly or in batches (which are copied
+ * with at most two memcpy() calls).
+ *
+ * ELEMRING_DECLARE_INLINE_WRAPPERS() can be used to generate type safe
+ * wrappers for a particular element type:
+ *
+ * \code
+ * ELEMRING_DECLARE_INLINE_WRAPPERS(sample_ring, int16_t)
+ *
+ * static int16_t samples[256];
+ * static elemring_t ring = ELEMRING_VAR_INIT(samples, sizeof(samples),
+ *                                            sizeof(samples[0]));
+ *
+ * n = sample_ring_pop_n(&ring, block, lengthof(block));
+ * \endcode
+ *
+ * The ring is thread safe (and SMP safe) only for one-to-one messaging.
+ * It may be used to pass data between an interrupt handler and a thread.
+ * One element of the buffer is always left empty.
+ *
+ * @{
+ */
+
+/*!
+ * \brief Element ring buffer descriptor.
+ */
+typedef struct {
+	char *basep;
+	uint32_t elem_size;
+	uint32_t num_elems;
+	atomic_uint readi;
+	atomic_uint writei;
+} elemring_t;
+
+/*!
+ * \brief Static initializer for an element ring buffer descriptor.
+ */
+#define ELEMRING_VAR_INIT(basep, base_len, elem_size) \
+	{ \
+		(char *) (basep), \
+		(elem_size), \
+		((base_len) / (elem_size)), \
+		ATOMIC_VAR_INIT(0), \
+		ATOMIC_VAR_INIT(0) \
+	}
+
+void elemring_init(elemring_t *r, void *basep, size_t base_len,
+		   size_t elem_size);
+
+/*!
+ * \brief Copy an element into the ring.
+ *
+ * \returns true on success, false if the ring is full.
+ */
+bool elemring_push(elemring_t *r, const void *elem);
+
+/*!
+ * \brief Copy an element out of the ring.
+ *
+ * \returns true on success, false if the ring is empty.
+ */
+bool elemring_pop(elemring_t *r, void *elem);
+
+/*!
+ * \brief Copy up to n elements into the ring.
+ *
+ * \returns The number of elements copied.
+ */
+size_t elemring_push_n(elemring_t *r, const void *elems, size_t n);
+
+/*!
+ * \brief Copy up to n elements out of the ring.
+ *
+ * \returns The number of elements copied.
+ */
+size_t elemring_pop_n(elemring_t *r, void *elems, size_t n);
+
+static inline bool elemring_empty(elemring_t *r)
+{
+	return atomic_load_explicit(&r->readi, memory_order_relaxed) ==
+	       atomic_load_explicit(&r->writei, memory_order_relaxed);
+}
+
+#define ELEMRING_DECLARE_INLINE_WRAPPERS(prefix, type)                         \
+	static inline void prefix##_init(elemring_t *r, type *base, size_t n)  \
+	{                                                                      \
+		elemring_init(r, base, n * sizeof(type), sizeof(type));        \
+	}                                                                      \
+                                                                               \
+	static inline bool prefix##_push(elemring_t *r, const type *elem)      \
+	{                                                                      \
+		return elemring_push(r, elem);                                 \
+	}                                                                      \
+                                                                               \
+	static inline bool prefix##_pop(elemring_t *r, type *elem)             \
+	{                                                                      \
+		return elemring_pop(r, elem);                                  \
+	}                                                                      \
+                                                                               \
+	static inline size_t prefix##_push_n(elemring_t *r, const type *elems, \
+					     size_t n)                         \
+	{                                                                      \
+		return elemring_push_n(r, elems, n);                           \
+	}                                                                      \
+                                                                               \
+	static inline size_t prefix##_pop_n(elemring_t *r, type *elems,        \
+					    size_t n)                          \
+	{                                                                      \
+		return elemring_pop_n(r, elems, n);                            \
+	}
+
+/*! @} */
+#endif // RF_ELEMRING_H_
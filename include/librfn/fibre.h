@@ -15,11 +15,21 @@
 #define RF_FIBRE_H_
 
 #include <stdint.h>
+#ifdef CONFIG_FIBRE_STATS
+#include <stdio.h>
+#endif
 
+#include "atomic.h"
+#include "dlist.h"
+#include "heap.h"
 #include "list.h"
 #include "messageq.h"
 #include "protothreads.h"
 
+#if defined(CONFIG_FIBRE_JOIN) && !defined(CONFIG_FIBRE_SYNC)
+#error CONFIG_FIBRE_JOIN requires CONFIG_FIBRE_SYNC
+#endif
+
 /*!
  * \defgroup librfn_fibre Fibre
  *
@@ -37,13 +47,29 @@ typedef enum {
 	FIBRE_STATE_EXITED = PT_EXITED,
 	FIBRE_STATE_FAILED = PT_FAILED,
 	FIBRE_STATE_RUNNING,
+	FIBRE_STATE_KILLED,
 
+	/*
+	 * The QUEUED bit is set whenever a fibre is a member of either the
+	 * run queue or the timer queue. It allows the kernel to track queue
+	 * membership without having to search the queues.
+	 */
 	FIBRE_STATE_QUEUED = 0x10,
 
 	FIBRE_STATE_TIMER_WAITING = FIBRE_STATE_WAITING | FIBRE_STATE_QUEUED,
 	FIBRE_STATE_RUNNABLE = FIBRE_STATE_RUNNING | FIBRE_STATE_QUEUED
 } fibre_state_t;
 
+/*!
+ * \brief Number of fibre priority levels.
+ *
+ * The scheduler uses a bitmap to find the highest priority runnable fibre
+ * so there can be at most 32 levels.
+ */
+#ifndef CONFIG_FIBRE_PRIORITIES
+#define CONFIG_FIBRE_PRIORITIES 8
+#endif
+
 /*!
  * \brief An approximation of infinitely far in the future.
  *
@@ -57,23 +83,127 @@ typedef enum {
 #define FIBRE_UNBOUNDED_SLEEP ((uint32_t) 0x7fffffff)
 
 struct fibre;
+struct fibre_cancel;
+struct fibre_kernel;
 typedef int fibre_entrypoint_t(struct fibre *);
+typedef void fibre_exit_fn_t(struct fibre *, int state);
+typedef void fibre_wakeup_t(void *ctx);
+typedef void fibre_wait_undo_t(dlist_t *waiters);
+
+/*!
+ * \brief Per-fibre statistics.
+ *
+ * All times are measured using time_now(). Latency is the interval between
+ * a fibre becoming runnable (or, for timers, the due time) and the fibre
+ * actually being run.
+ */
+typedef struct fibre_stats {
+	const char *name;
+	uint32_t runs;
+	uint32_t max_run_time;
+	uint64_t total_run_time;
+	uint32_t wakes;
+	uint32_t max_latency;
+	uint64_t total_latency;
+
+	/* private */
+	uint32_t woken;
+	bool waking;
+	list_node_t link;
+} fibre_stats_t;
+
+/*!
+ * \brief Static initializer for a per-fibre statistics structure.
+ */
+#define FIBRE_STATS_VAR_INIT(n) { .name = (n) }
+
+/*!
+ * \brief Scheduler statistics (summed across all workers).
+ */
+typedef struct {
+	uint32_t passes;	//!< Calls to fibre_scheduler_next()
+	uint32_t fast_path;	//!< Passes that skipped the scheduler updates
+	uint32_t taint_events;	//!< Number of times the kernel was tainted
+	uint32_t taint_flags;	//!< Bitmask of taints (bit 0 is 'A')
+} fibre_kernel_stats_t;
 
 /*!
  * \brief Fibre descriptor.
+ *
+ * Optional features are only paid for when they are enabled:
+ *
+ * - CONFIG_FIBRE_SYNC adds wait lists (fibre_wait_state() and friends),
+ *   which are required by the \ref librfn_fibresync objects.
+ * - CONFIG_FIBRE_JOIN adds fibre_join(), exit and cleanup handlers and
+ *   cancellation tokens. It requires CONFIG_FIBRE_SYNC.
+ * - CONFIG_FIBRE_STATS adds per-fibre statistics.
+ * - CONFIG_FIBRE_WAIT_FD adds fibre_wait_fd().
+ *
+ * \note The layout depends on the CONFIG_FIBRE_ options (which configure
+ *       defines on the compiler command line). They must be defined
+ *       identically for the library and for everything that uses it.
  */
 typedef struct fibre {
 	fibre_entrypoint_t *fn;
 	uint16_t state;
 	uint16_t priv;
 	uint32_t duetime;
-	list_node_t link;
+	uint32_t slack;
+	uint8_t priority;
+	atomic_uchar wake_pending;
+#ifdef CONFIG_FIBRE_SYNC
+	bool wait_released;
+	bool wait_seen;
+#endif
+	dlist_node_t link;
+	heap_node_t timer;
+	struct fibre *wake_next;
+#ifdef CONFIG_FIBRE_STATS
+	fibre_stats_t *stats;
+#endif
+#ifdef CONFIG_FIBRE_SYNC
+	dlist_node_t wait_link;
+	dlist_t *wait_list;
+	fibre_wait_undo_t *wait_undo;
+#endif
+#ifdef CONFIG_FIBRE_JOIN
+	dlist_t joiners;
+	fibre_exit_fn_t *on_exit;
+	fibre_exit_fn_t *cleanup;
+	struct fibre_cancel *cancel;
+	struct fibre *cancel_next;
+#endif
+#ifdef CONFIG_FIBRE_SMP
+	struct fibre_kernel *_Atomic owner;
+#endif
+#ifdef CONFIG_FIBRE_WAIT_FD
+	int wait_fd;
+#endif
 } fibre_t;
 
 /*!
  * \brief Static initializer for a fibre descriptor.
  */
-#define FIBRE_VAR_INIT(fn) { (fn), 0, 0, 0, LIST_NODE_VAR_INIT }
+#define FIBRE_VAR_INIT(entrypoint) { .fn = (entrypoint) }
+
+/*!
+ * \brief Cancellation token.
+ *
+ * A cancellation token can be shared by any number of fibres. Cancelling
+ * the token removes every bound fibre from whatever queue it is waiting
+ * on and runs it so that it can observe fibre_cancelled() and clean up.
+ */
+typedef struct fibre_cancel {
+	bool cancelled;
+	fibre_t *fibres;
+} fibre_cancel_t;
+#define FIBRE_CANCEL_VAR_INIT { 0 }
+
+typedef enum {
+	FIBRE_WAIT_NONE,
+	FIBRE_WAIT_PENDING,
+	FIBRE_WAIT_RELEASED
+} fibre_wait_state_t;
 
 /*!
  * \brief Fibre and eventq descriptor.
@@ -143,6 +273,19 @@ uint32_t fibre_scheduler_next(uint32_t time);
  */
 void fibre_init(fibre_t *f, fibre_entrypoint_t *fn);
 
+/*!
+ * Change the priority of a fibre.
+ *
+ * A runnable fibre will always be scheduled ahead of any runnable fibre with
+ * a lower priority value. Fibres with the same priority are scheduled
+ * round-robin. All fibres are initialized with a priority of zero (the
+ * lowest priority) meaning that, by default, all fibres share a single run
+ * queue.
+ *
+ * \param priority Priority from 0 to CONFIG_FIBRE_PRIORITIES-1.
+ */
+void fibre_set_priority(fibre_t *f, unsigned int priority);
+
 /*!
  * Make a fibre runnable.
  *
@@ -160,11 +303,163 @@ void fibre_run(fibre_t *f);
  * This function behaves similarly fibre_run(). It is less efficient than
  * the alternative but can be used from any calling context, including from an
  * interrupt service routine.
+ *
+ * Wake ups are recorded on a lock-free list threaded through the fibre
+ * descriptors so this function never fails. Repeated calls made before the
+ * scheduler gets a chance to act are merged.
+ *
+ * \returns Always true (the return value is retained for compatibility).
  */
 bool fibre_run_atomic(fibre_t *f);
 
+#ifdef CONFIG_FIBRE_STATS
+/*!
+ * \brief Enable (or, if stats is NULL, disable) statistics for a fibre.
+ *
+ * Fibres without statistics attached pay no accounting overhead.
+ *
+ * \note Only available if CONFIG_FIBRE_STATS is defined.
+ *
+ * \warning This function is not thread-safe; attach statistics before
+ *          starting additional workers.
+ */
+void fibre_set_stats(fibre_t *f, fibre_stats_t *stats);
+#endif
+
+/*!
+ * \brief Collect the scheduler wide statistics.
+ */
+void fibre_get_kernel_stats(fibre_kernel_stats_t *stats);
+
+/*!
+ * \brief Configure the scheduler watchdog.
+ *
+ * When run_budget is non-zero any single invocation of a fibre that takes
+ * longer than run_budget microseconds taints the kernel with 'W'. When
+ * late_budget is non-zero any timer that expires more than late_budget
+ * microseconds after its due time taints the kernel with 'L'. In both
+ * cases the offending fibre is recorded using mlog().
+ *
+ * Both checks are disabled by default. Enabling the run budget requires
+ * two calls to time_now() for every fibre invocation.
+ */
+void fibre_watchdog_set(uint32_t run_budget, uint32_t late_budget);
+
+#ifdef CONFIG_FIBRE_STATS
+/*!
+ * \brief Print the scheduler and per-fibre statistics.
+ *
+ * \note Only available if CONFIG_FIBRE_STATS is defined.
+ */
+void fibre_stats_dump(FILE *out);
+#endif
+
+#ifdef CONFIG_FIBRE_JOIN
+/*!
+ * \brief Wait for another fibre to exit.
+ *
+ * Combining this function with PT_WAIT_UNTIL() allows a fibre to sleep
+ * until the target exits, fails or is killed. Returns true immediately if
+ * the target has already exited or been killed (and has not been run
+ * again since).
+ */
+bool fibre_join(fibre_t *f);
+
+/*!
+ * \brief Register a function to be called when a fibre exits.
+ *
+ * The function is called from the scheduler with state set to
+ * FIBRE_STATE_EXITED, FIBRE_STATE_FAILED or (if the fibre was killed)
+ * FIBRE_STATE_WAITING.
+ */
+void fibre_set_exit_handler(fibre_t *f, fibre_exit_fn_t *fn);
+
+/*!
+ * \brief Register a function to release the resources of a fibre.
+ *
+ * Intended for code that builds other kinds of fibre on top of the
+ * scheduler (such as stackful fibres) and independent of any exit
+ * handler. The function is called, with the same state as an exit
+ * handler, whenever the fibre exits, fails or is killed.
+ */
+void fibre_set_cleanup_handler(fibre_t *f, fibre_exit_fn_t *fn);
+
+void fibre_cancel_init(fibre_cancel_t *c);
+
+/*!
+ * \brief Bind a fibre to a cancellation token.
+ *
+ * A fibre can be bound to only one token. The binding lasts until the
+ * fibre exits or is killed (or the token is re-initialized).
+ */
+void fibre_cancel_bind(fibre_cancel_t *c, fibre_t *f);
+
+/*!
+ * \brief Cancel all fibres bound to a token.
+ */
+void fibre_cancel(fibre_cancel_t *c);
+
+/*!
+ * \brief Test whether the current fibre has been cancelled.
+ *
+ * This is typically combined with a blocking call:
+ *
+ * \code
+ * PT_WAIT_UNTIL(fibre_cancelled() || fibre_sem_wait(&sem));
+ * if (fibre_cancelled())
+ *         PT_EXIT();
+ * \endcode
+ */
+bool fibre_cancelled(void);
+#endif
+
+#ifdef CONFIG_FIBRE_SYNC
+/*!
+ * \brief Query the current fibre's progress through a wait list.
+ *
+ * This, together with fibre_wait_enqueue() and fibre_wait_release(), is
+ * the building block for fibre synchronization objects. A released fibre
+ * reverts to FIBRE_WAIT_NONE after this function reports the release.
+ *
+ * A wait must be queried each time the fibre runs (PT_WAIT_UNTIL() does
+ * this naturally). A wait that is not queried, for example because
+ * fibre_timeout() fired first, is treated as abandoned and is withdrawn
+ * when the fibre stops running; any resource already handed to it is
+ * given back through the undo hook.
+ */
+fibre_wait_state_t fibre_wait_state(dlist_t *waiters);
+
+/*!
+ * \brief Add the current fibre to a wait list.
+ *
+ * Any abandoned wait the fibre is still registered with is withdrawn
+ * first.
+ */
+void fibre_wait_enqueue(dlist_t *waiters);
+
+/*!
+ * \brief Release (and run) the first fibre on a wait list.
+ *
+ * \returns The fibre released or NULL if the list was empty.
+ */
+fibre_t *fibre_wait_release(dlist_t *waiters);
+
+/*!
+ * \brief Release the first fibre on a wait list and hand it a resource.
+ *
+ * Behaves like fibre_wait_release() but, if the released fibre is
+ * cancelled, killed or exits before fibre_wait_state() reports the
+ * release, undo is called (with the same waiters list) so the resource
+ * can be handed on rather than lost.
+ */
+fibre_t *fibre_wait_handover(dlist_t *waiters, fibre_wait_undo_t *undo);
+#endif
+
 /*!
  * Remove a fibre from the run queue.
+ *
+ * \note On SMP systems this function must be called by the worker that
+ *       owns the fibre; it will fail if called by any other worker.
  */
 bool fibre_kill(fibre_t *f);
 
@@ -177,6 +472,16 @@ bool fibre_kill(fibre_t *f);
  */
 bool fibre_timeout(uint32_t duetime);
 
+/*!
+ * Sleep until a timeout is reached, allowing the wake up to be deferred.
+ *
+ * Behaves like fibre_timeout() except that the scheduler may run the fibre
+ * at any time between duetime and duetime + slack. This allows timers
+ * whose windows overlap to be released together, reducing the number of
+ * wake ups and scheduler passes.
+ */
+bool fibre_timeout_slack(uint32_t duetime, uint32_t slack);
+
 /*!
  * \brief Dynamic initializer for a fibre and eventq descriptor.
  */
@@ -218,6 +523,37 @@ void *fibre_eventq_receive(fibre_eventq_t *evtq);
  */
 void fibre_eventq_release(fibre_eventq_t *evtq, void *evtp);
 
+/*!
+ * \brief Request memory resources to send a batch of events to a fibre.
+ *
+ * See messageq_claim_span() for details of how *n is updated.
+ *
+ * \note If the fibre's event queue is full the kernel will automtically
+ *       be tainted (the 'E' bit will be set).
+ */
+void *fibre_eventq_claim_span(fibre_eventq_t *evtq, unsigned int *n);
+
+/*!
+ * \brief Send a batch of events to a fibre using a single wake up.
+ */
+bool fibre_eventq_send_span(fibre_eventq_t *evtq, void *evtp, unsigned int n);
+
+/*!
+ * \brief Receive all (contiguous) pending events in one go.
+ *
+ * See messageq_receive_span() for details of how *n is updated.
+ *
+ * \warning This function should only be called by the fibre bound to the
+ *          event queue and must not be called by an interrupt service routine.
+ */
+void *fibre_eventq_receive_span(fibre_eventq_t *evtq, unsigned int *n);
+
+/*!
+ * \brief Release a batch of events previously received by a fibre.
+ */
+void fibre_eventq_release_span(fibre_eventq_t *evtq, void *evtp,
+			       unsigned int n);
+
 /*!
  * Enter the scheduler main loop.
  *
@@ -233,6 +569,92 @@ void fibre_eventq_release(fibre_eventq_t *evtq, void *evtp);
  */
 void fibre_scheduler_main_loop(void);
 
+/*!
+ * \brief Sleep until a file descriptor is ready.
+ *
+ * Combining this function with PT_WAIT_UNTIL() allows a fibre to wait for
+ * I/O. events is a mask of poll() events (POLLIN, POLLOUT, etc).
+ * The scheduler main loop will run the fibre when the descriptor becomes
+ * ready, which allows a single thread to serve many descriptors without
+ * any helper threads.
+ *
+ * A descriptor is registered with the scheduler only until the fibre next
+ * becomes runnable (for any reason), exits or is killed. This makes it
+ * safe to combine with other wait conditions, such as fibre_timeout().
+ * A fibre may wait for several descriptors at once but only the most
+ * recent waiter for each descriptor will be woken.
+ *
+ * \note Only available on hosts that support epoll() (see
+ *       CONFIG_FIBRE_WAIT_FD).
+ *
+ * \returns true if the descriptor is ready (or has an error condition),
+ *          otherwise false.
+ */
+#ifdef CONFIG_FIBRE_WAIT_FD
+bool fibre_wait_fd(int fd, uint32_t events);
+
+/*!
+ * \brief Drop any descriptors registered by fibre_wait_fd().
+ *
+ * Called by the scheduler; there is no need to call this directly.
+ */
+void fibre_wait_fd_withdraw(fibre_t *f);
+#endif
+
+/*!
+ * \brief Register a function to wake the scheduler from an idle sleep.
+ *
+ * The function is called (possibly from another thread or from an
+ * interrupt handler) when fibre_run_atomic() is used whilst the scheduler
+ * is sleeping. It must therefore be safe to call from any context.
+ */
+void fibre_scheduler_set_wakeup(fibre_wakeup_t *fn, void *ctx);
+
+/*!
+ * \brief Announce that the scheduler is about to sleep.
+ *
+ * Must be called after fibre_scheduler_next() and before the scheduler
+ * starts sleeping. Once called any atomic wake up will cause the wakeup
+ * function to be called.
+ *
+ * \returns false if a wake up is already pending (in which case the
+ *          scheduler must not sleep).
+ */
+bool fibre_scheduler_sleep_begin(void);
+
+/*!
+ * \brief Announce that the scheduler has stopped sleeping.
+ */
+void fibre_scheduler_sleep_end(void);
+
+#ifdef CONFIG_FIBRE_SMP
+/*!
+ * \brief Attach a private scheduler to the calling thread.
+ *
+ * Each worker thread has its own run queue and timer queue. A fibre belongs
+ * to the worker that first runs it and calls to fibre_run() or
+ * fibre_run_atomic() from any other thread are routed to the owning worker.
+ *
+ * Idle workers advertise that they want work and busy workers respond by
+ * handing over runnable fibres (lowest priority first) at their next
+ * scheduling point. Since protothreads keep their state in the fibre
+ * descriptor a fibre can safely migrate whenever it is not running.
+ *
+ * Threads that never attach share a default scheduler.
+ *
+ * \returns false if too many (more than 32) workers have been attached.
+ */
+bool fibre_scheduler_attach(void);
+
+/*!
+ * Enter the scheduler main loop with multiple worker threads.
+ *
+ * The calling thread becomes the first worker and an additional nthreads-1
+ * worker threads are started. This function does not return.
+ */
+void fibre_scheduler_main_loop_smp(unsigned int nthreads);
+#endif
+
 /*! @} */
 
 #endif // RF_FIBRE_H_
@@ -0,0 +1,162 @@
+/*
+ * fibresync.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_FIBRESYNC_H_
+#define RF_FIBRESYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dlist.h"
+#include "fibre.h"
+
+/*!
+ * \defgroup librfn_fibresync Fibre synchronization
+ *
+ * \brief Mutexes, semaphores, condition variables and event groups for
+ *        fibres.
+ *
+ * All the blocking functions are designed to be used with PT_WAIT_UNTIL()
+ * (or STACKFIBRE_WAIT_UNTIL()). They return true when the fibre may
+ * proceed, otherwise they add the fibre to the object's wait list and
+ * return false. A blocked fibre is not run again until it is released
+ * so contended waits do not consume any CPU time.
+ *
+ * Mutexes and semaphores hand over directly to the first waiter, making
+ * them fair (FIFO). A fibre may wait on only one object at a time. Killing
+ * or cancelling (see fibre_cancel()) a waiting fibre withdraws it from the
+ * wait list.
+ *
+ * Waits may be combined with other conditions, such as a timeout:
+ *
+ * \code
+ * PT_WAIT_UNTIL(fibre_sem_wait(&s) || fibre_timeout(deadline));
+ * \endcode
+ *
+ * A wait that is abandoned this way is withdrawn automatically and
+ * anything already handed over to it is passed on to the next waiter.
+ *
+ * \note These objects may only be used from fibres and only by fibres
+ *       belonging to the same scheduler. They are not interrupt safe.
+ *
+ * \note Requires CONFIG_FIBRE_SYNC.
+ *
+ * @{
+ */
+
+typedef struct {
+	fibre_t *owner;
+	dlist_t waiters;
+} fibre_mutex_t;
+#define FIBRE_MUTEX_VAR_INIT { 0 }
+
+void fibre_mutex_init(fibre_mutex_t *m);
+
+/*!
+ * \brief Acquire a mutex.
+ *
+ * \code
+ * PT_WAIT_UNTIL(fibre_mutex_lock(&m));
+ * \endcode
+ */
+bool fibre_mutex_lock(fibre_mutex_t *m);
+
+/*!
+ * \brief Release a mutex (which must be held by the current fibre).
+ */
+void fibre_mutex_unlock(fibre_mutex_t *m);
+
+typedef struct {
+	unsigned int count;
+	dlist_t waiters;
+} fibre_sem_t;
+#define FIBRE_SEM_VAR_INIT(count) { (count), DLIST_VAR_INIT }
+
+void fibre_sem_init(fibre_sem_t *s, unsigned int count);
+
+/*!
+ * \brief Decrement a semaphore, waiting until it is non-zero.
+ */
+bool fibre_sem_wait(fibre_sem_t *s);
+
+/*!
+ * \brief Increment a semaphore (or release a waiter).
+ *
+ * Unlike the other functions in this module this may be called from code
+ * that is not running in a fibre.
+ */
+void fibre_sem_post(fibre_sem_t *s);
+
+typedef struct {
+	dlist_t waiters;
+} fibre_cond_t;
+#define FIBRE_COND_VAR_INIT { DLIST_VAR_INIT }
+
+void fibre_cond_init(fibre_cond_t *c);
+
+/*!
+ * \brief Wait for a condition to be signalled.
+ *
+ * The mutex, which must be held by the current fibre, is released whilst
+ * waiting and is reacquired before this function returns true. A fibre
+ * that abandons the wait (for example on a timeout) does not hold the
+ * mutex.
+ *
+ * \code
+ * PT_WAIT_UNTIL(fibre_mutex_lock(&m));
+ * while (!ready)
+ *         PT_WAIT_UNTIL(fibre_cond_wait(&c, &m));
+ * fibre_mutex_unlock(&m);
+ * \endcode
+ */
+bool fibre_cond_wait(fibre_cond_t *c, fibre_mutex_t *m);
+
+/*!
+ * \brief Release the first fibre waiting on a condition.
+ */
+void fibre_cond_signal(fibre_cond_t *c);
+
+/*!
+ * \brief Release all fibres waiting on a condition.
+ */
+void fibre_cond_broadcast(fibre_cond_t *c);
+
+typedef struct {
+	uint32_t flags;
+	dlist_t waiters;
+} fibre_event_t;
+#define FIBRE_EVENT_VAR_INIT { 0, DLIST_VAR_INIT }
+
+void fibre_event_init(fibre_event_t *e);
+
+/*!
+ * \brief Wait until any of the flags in mask are set.
+ */
+bool fibre_event_wait_any(fibre_event_t *e, uint32_t mask);
+
+/*!
+ * \brief Wait until all of the flags in mask are set.
+ */
+bool fibre_event_wait_all(fibre_event_t *e, uint32_t mask);
+
+/*!
+ * \brief Set flags and release any fibres waiting on the event group.
+ *
+ * May be called from code that is not running in a fibre.
+ */
+void fibre_event_set(fibre_event_t *e, uint32_t mask);
+
+void fibre_event_clear(fibre_event_t *e, uint32_t mask);
+
+/*! @} */
+#endif // RF_FIBRESYNC_H_
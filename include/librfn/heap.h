@@ -0,0 +1,93 @@
+/*
+ * heap.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_HEAP_H_
+#define RF_HEAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * \defgroup librfn_heap Priority queue
+ *
+ * \brief An intrusive pairing heap with O(1) insert and O(log n) amortized
+ *        extraction and removal.
+ *
+ * The heap is stable: nodes that compare equal are extracted in the order
+ * they were inserted.
+ *
+ * No form of internal locking or other thread-safety is provided.
+ *
+ * @{
+ */
+
+typedef struct heap_node {
+	struct heap_node *child;
+	struct heap_node *sibling;
+	struct heap_node *prev; /* parent if first child, else left sibling */
+	uint32_t seq;
+} heap_node_t;
+#define HEAP_NODE_VAR_INIT { 0 }
+
+typedef int heap_node_compare_t(heap_node_t *, heap_node_t *);
+
+typedef struct {
+	heap_node_t *root;
+	heap_node_compare_t *nodecmp;
+	uint32_t seq;
+} heap_t;
+#define HEAP_VAR_INIT(nodecmp) { NULL, (nodecmp), 0 }
+
+void heap_init(heap_t *heap, heap_node_compare_t *nodecmp);
+
+/*!
+ * \brief Insert a node into the heap.
+ *
+ * The node must not already be a member of any heap.
+ */
+void heap_insert(heap_t *heap, heap_node_t *node);
+
+/*!
+ * \brief Remove and return the smallest node in the heap.
+ */
+heap_node_t *heap_extract(heap_t *heap);
+
+/*!
+ * \brief Remove a node from anywhere in the heap.
+ *
+ * \returns true if the node was a member of the heap, otherwise false.
+ */
+bool heap_remove(heap_t *heap, heap_node_t *node);
+
+static inline bool heap_empty(heap_t *heap)
+{
+	return !heap->root;
+}
+
+static inline heap_node_t *heap_peek(heap_t *heap)
+{
+	return heap->root;
+}
+
+/*!
+ * \brief Test whether a node is a member of the heap in O(1) time.
+ *
+ * Only valid if the node is not a member of some other heap.
+ */
+static inline bool heap_contains(heap_t *heap, heap_node_t *node)
+{
+	return node->prev || heap->root == node;
+}
+
+/*! @} */
+#endif // RF_HEAP_H_
@@ -0,0 +1,106 @@
+/*
+ * lfstack.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_LFSTACK_H_
+#define RF_LFSTACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "list.h"
+
+/*!
+ * \defgroup librfn_lfstack Lock-free stack
+ *
+ * \brief Lock-free (Treiber) stack of intrusive \ref librfn_list "list"
+ *        nodes.
+ *
+ * The stack is intended for free lists and for handing nodes between
+ * threads (or from interrupt handlers) without a lock. Pushing is always
+ * safe from any number of threads.
+ *
+ * A naive lock-free pop suffers from the ABA problem: if a node is popped
+ * and pushed again while another thread is part way through a pop then
+ * that thread may install a stale next pointer. Where the platform
+ * provides a double word compare-and-swap the stack pairs the top pointer
+ * with a modification count which defeats this, and ::LFSTACK_ABA_SAFE is
+ * set. Elsewhere lfstack_pop() must not be called concurrently with
+ * either itself or lfstack_pop_all() (a single consumer, or consumers
+ * serialized by the caller, is sufficient). Without the modification
+ * count a pop racing with lfstack_pop_all() is just as exposed to ABA if
+ * the drained nodes are pushed again. lfstack_pop_all() may always run
+ * concurrently with itself and with lfstack_push().
+ *
+ * Popped nodes may still be examined by a racing pop so their memory must
+ * remain valid (although its contents need not) after they are popped.
+ * Nodes recycled through a free list naturally meet this requirement.
+ *
+ * @{
+ */
+
+#if (UINTPTR_MAX == UINT32_MAX && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)) || \
+    (UINTPTR_MAX == UINT64_MAX && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16))
+#define LFSTACK_ABA_SAFE 1
+#else
+#define LFSTACK_ABA_SAFE 0
+#endif
+
+typedef union {
+	struct {
+		list_node_t *top;
+		uintptr_t tag;
+	} head;
+#if LFSTACK_ABA_SAFE && UINTPTR_MAX == UINT32_MAX
+	uint64_t raw;
+#elif LFSTACK_ABA_SAFE
+	unsigned __int128 raw;
+#endif
+} __attribute__((aligned(2 * sizeof(uintptr_t)))) lfstack_t;
+#define LFSTACK_VAR_INIT { { 0 } }
+
+/*!
+ * \brief Push a node onto the stack.
+ *
+ * Safe to call from any number of threads concurrently.
+ */
+void lfstack_push(lfstack_t *s, list_node_t *node);
+
+/*!
+ * \brief Pop a node from the stack.
+ *
+ * Unless ::LFSTACK_ABA_SAFE is set this must not be called concurrently
+ * with any other pop.
+ *
+ * \returns The most recently pushed node or NULL if the stack is empty.
+ */
+list_node_t *lfstack_pop(lfstack_t *s);
+
+/*!
+ * \brief Atomically take every node from the stack.
+ *
+ * \returns A NULL terminated chain of nodes (linked by their next
+ *          pointers) in most recently pushed first order, or NULL if the
+ *          stack was empty.
+ */
+list_node_t *lfstack_pop_all(lfstack_t *s);
+
+/*!
+ * \brief Test whether the stack is empty.
+ *
+ * The result may be stale by the time it is returned if other threads
+ * are using the stack.
+ */
+bool lfstack_empty(lfstack_t *s);
+
+/*! @} */
+#endif // RF_LFSTACK_H_
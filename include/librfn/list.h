@@ -73,6 +73,41 @@ list_node_t * list_iterator_next(list_iterator_t *iter);
 void list_iterator_insert(list_iterator_t *iter, list_node_t *node);
 list_node_t * list_iterator_remove(list_iterator_t *iter);
 
+/*
+ * bulk operations
+ */
+
+/*!
+ * \brief Move every node from src to the tail of list.
+ *
+ * This is a constant time operation. src is left empty.
+ */
+void list_splice(list_t *list, list_t *src);
+
+/*!
+ * \brief Move every node that follows node into rest.
+ *
+ * This is a constant time operation. If node is NULL then every node in
+ * the list is moved. rest must be empty.
+ */
+void list_split(list_t *list, list_node_t *node, list_t *rest);
+
+/*!
+ * \brief Merge the sorted list src into the sorted list list.
+ *
+ * The merge is stable; when nodes compare equal those from list come first.
+ * src is left empty.
+ */
+void list_merge_sorted(list_t *list, list_t *src, list_node_compare_t *nodecmp);
+
+/*!
+ * \brief Sort a list.
+ *
+ * This is a stable, bottom-up merge sort. It runs in O(n log n) time and
+ * does not allocate memory.
+ */
+void list_sort(list_t *list, list_node_compare_t *nodecmp);
+
 /*
  * search operations
  */
@@ -35,6 +35,12 @@
  *
  * \note The message queue implementation uses a bitfield to track state.
  *       For this reasons it cannot manage queues deeper than 32 messages.
+ *
+ * \note The layout of messageq_t (and therefore of fibre_eventq_t)
+ *       depends on CONFIG_MESSAGEQ_WAIT, which configure defines on the
+ *       compiler command line when the blocking calls are available. It
+ *       must be defined identically for the library and for everything
+ *       that uses it.
  * @{
  */
 
@@ -49,6 +55,11 @@ typedef struct {
 
 	unsigned char receivep;
 
+#ifdef CONFIG_MESSAGEQ_WAIT
+	/* used only by the blocking calls (and zero initialized) */
+	atomic_uint waiters;
+	atomic_uint wake_seq;
+#endif
 } messageq_t;
 
 #define MESSAGEQ_VAR_INIT(basep, base_len, msg_len) \
@@ -69,6 +80,76 @@ void messageq_send(messageq_t *mq, void *msg);
 void *messageq_receive(messageq_t *mq);
 void messageq_release(messageq_t *mq, void *msg);
 
+/*!
+ * \brief Claim a contiguous span of messages.
+ *
+ * On entry *n is the maximum number of messages to claim. On exit it holds
+ * the number actually claimed, which may be fewer than requested either
+ * because the queue is nearly full or because a span never wraps around
+ * the end of the queue's buffer.
+ *
+ * \returns Pointer to the first message in the span or NULL if nothing
+ *          could be claimed.
+ */
+void *messageq_claim_span(messageq_t *mq, unsigned int *n);
+
+/*!
+ * \brief Send all the messages in a span claimed with messageq_claim_span().
+ *
+ * A span may be sent in several pieces providing each piece is contiguous.
+ */
+void messageq_send_span(messageq_t *mq, void *msg, unsigned int n);
+
+/*!
+ * \brief Receive a contiguous span of pending messages.
+ *
+ * On entry *n is the maximum number of messages to receive. On exit it
+ * holds the number actually received.
+ *
+ * \returns Pointer to the first message in the span or NULL if no message
+ *          is pending.
+ */
+void *messageq_receive_span(messageq_t *mq, unsigned int *n);
+
+/*!
+ * \brief Release a span of received messages.
+ */
+void messageq_release_span(messageq_t *mq, void *msg, unsigned int n);
+
+#define MESSAGEQ_WAIT_FOREVER UINT32_MAX
+
+/*!
+ * \brief Claim a message, blocking the calling thread if the queue is full.
+ *
+ * Only available on POSIX systems (with futexes). Must not be called from
+ * a fibre.
+ *
+ * \param timeout Maximum time to wait in microseconds (any value up to
+ *                about 71 minutes) or MESSAGEQ_WAIT_FOREVER.
+ * \returns Pointer to the message or NULL if the timeout expired.
+ */
+void *messageq_claim_wait(messageq_t *mq, uint32_t timeout);
+
+/*!
+ * \brief Receive a message, blocking the calling thread until one arrives.
+ *
+ * Only available on POSIX systems (with futexes). Must not be called from
+ * a fibre.
+ *
+ * \param timeout Maximum time to wait in microseconds (any value up to
+ *                about 71 minutes) or MESSAGEQ_WAIT_FOREVER.
+ * \returns Pointer to the message or NULL if the timeout expired.
+ */
+void *messageq_receive_wait(messageq_t *mq, uint32_t timeout);
+
+/*!
+ * \brief Wake any threads blocked on the queue.
+ *
+ * This is called automatically by the send and release functions whenever
+ * a thread is blocked so it need not be called directly.
+ */
+void messageq_wake(messageq_t *mq);
+
 static inline bool messageq_empty(messageq_t *mq)
 {
 	return 0 == (atomic_load(&mq->full_flags) & (1 << mq->receivep));
@@ -0,0 +1,114 @@
+/*
+ * mpmcq.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_MPMCQ_H_
+#define RF_MPMCQ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+/*!
+ * \defgroup librfn_mpmcq Multi-producer/multi-consumer message queue
+ *
+ * \brief Lockless bounded message queue using C11 atomic operations.
+ *
+ * This is a sequence numbered ring (based on Dmitry Vyukov's bounded MPMC
+ * queue) with the same claim/send/receive/release interface as the
+ * \ref librfn_messageq "message queue". Unlike the message queue any
+ * number of threads may send *and* receive messages and the queue may be
+ * any power-of-two number of messages deep.
+ *
+ * Each message slot has a sequence number that records whether it is free
+ * or full and in which lap of the ring. These are stored in a separate
+ * array provided by the caller, which must be zero initialized (static
+ * storage is sufficient).
+ *
+ * \code
+ * static my_msg_t msgs[128];
+ * static atomic_uint seqs[128];
+ * static mpmcq_t q = MPMCQ_VAR_INIT(msgs, seqs, sizeof(msgs), sizeof(msgs[0]));
+ * \endcode
+ *
+ * Messages are claimed and received in order but may be sent and released
+ * out of order. A slow sender (or receiver) does not block other threads
+ * from using the slots around it but it will stop the queue making progress
+ * past its slot once the ring wraps round.
+ *
+ * @{
+ */
+
+/*!
+ * \brief Multi-producer/multi-consumer queue descriptor.
+ *
+ * The send and receive indices each occupy their own cache line to
+ * prevent false sharing between the producers and consumers.
+ */
+typedef struct {
+	char *basep;
+	atomic_uint *seqp;
+	uint32_t msg_len;
+	uint32_t mask;
+
+	atomic_uint sendp __attribute__((aligned(CONFIG_CACHE_LINE_SIZE)));
+	atomic_uint receivep __attribute__((aligned(CONFIG_CACHE_LINE_SIZE)));
+} mpmcq_t;
+
+/*!
+ * \brief Static initializer for a queue.
+ *
+ * base_len / msg_len must be a power of two and seqp must point to an
+ * array containing (at least) that many zero initialized sequence numbers.
+ */
+#define MPMCQ_VAR_INIT(basep, seqp, base_len, msg_len) \
+	{ \
+		(char *) (basep), \
+		(seqp), \
+		(msg_len), \
+		((base_len) / (msg_len)) - 1, \
+		ATOMIC_VAR_INIT(0), \
+		ATOMIC_VAR_INIT(0) \
+	}
+
+void mpmcq_init(mpmcq_t *q, void *basep, atomic_uint *seqp, size_t base_len,
+		size_t msg_len);
+
+/*!
+ * \brief Claim a free message slot.
+ *
+ * \returns Pointer to the message or NULL if the queue is full.
+ */
+void *mpmcq_claim(mpmcq_t *q);
+
+/*!
+ * \brief Send a message previously claimed with mpmcq_claim().
+ */
+void mpmcq_send(mpmcq_t *q, void *msg);
+
+/*!
+ * \brief Receive the oldest pending message.
+ *
+ * \returns Pointer to the message or NULL if the queue is empty (or the
+ *          oldest message has been claimed but not yet sent).
+ */
+void *mpmcq_receive(mpmcq_t *q);
+
+/*!
+ * \brief Release a message previously received with mpmcq_receive().
+ */
+void mpmcq_release(mpmcq_t *q, void *msg);
+
+/*! @} */
+#endif // RF_MPMCQ_H_
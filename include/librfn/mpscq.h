@@ -0,0 +1,81 @@
+/*
+ * mpscq.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_MPSCQ_H_
+#define RF_MPSCQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "atomic.h"
+#include "list.h"
+
+/*!
+ * \defgroup librfn_mpscq Intrusive MPSC queue
+ *
+ * \brief Lock-free multi-producer/single-consumer FIFO of intrusive
+ *        \ref librfn_list "list" nodes.
+ *
+ * Unlike the \ref librfn_messageq "message queue" the queue has no fixed
+ * capacity; any node embedded in a larger structure can be queued. This
+ * makes it well suited to handing work between threads (or from interrupt
+ * handlers to a thread) without copying.
+ *
+ * Inserting a node is wait-free: each producer performs a single atomic
+ * exchange followed by a store. Extraction must be performed by a single
+ * consumer. If a producer is pre-empted part way through an insertion the
+ * consumer cannot see past the incomplete node and mpscq_extract() will
+ * report the queue as empty until the producer resumes.
+ *
+ * As with the singly linked list a zero initialized queue is valid and
+ * empty.
+ *
+ * @{
+ */
+
+typedef struct {
+	/* written by the consumer */
+	list_node_t *head;
+
+	/* written by the producers */
+	list_node_t *tail __attribute__((aligned(CONFIG_CACHE_LINE_SIZE)));
+	list_node_t stub;
+} mpscq_t;
+#define MPSCQ_VAR_INIT { 0 }
+
+/*!
+ * \brief Append a node to the queue.
+ *
+ * Safe to call from any number of threads concurrently.
+ */
+void mpscq_insert(mpscq_t *q, list_node_t *node);
+
+/*!
+ * \brief Remove the node at the head of the queue.
+ *
+ * Must only be called by the consumer.
+ *
+ * \returns The oldest node in the queue or NULL if the queue is empty (or
+ *          the oldest node has not been completely inserted).
+ */
+list_node_t *mpscq_extract(mpscq_t *q);
+
+/*!
+ * \brief Test whether the queue is empty.
+ *
+ * Must only be called by the consumer.
+ */
+bool mpscq_empty(mpscq_t *q);
+
+/*! @} */
+#endif // RF_MPSCQ_H_
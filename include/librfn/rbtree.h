@@ -0,0 +1,205 @@
+/*
+ * rbtree.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_RBTREE_H_
+#define RF_RBTREE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bintree.h"
+#include "util.h"
+
+/*!
+ * \defgroup librfn_rbtree Red-black tree
+ *
+ * \brief A self-balancing ordered map built from \ref librfn_bintree
+ *        "binary tree" nodes.
+ *
+ * Insertion, removal and every search are O(log n). The nodes are
+ * intended to be embedded within other structures, and because each node
+ * begins with an ordinary bintree_node_t the bintree traversal, iteration
+ * and visualization functions can be applied to rbtree_t::root.
+ *
+ * Nodes do not record their parent so insertion and removal both use
+ * top-down algorithms that rebalance the tree on the way down. Keys must
+ * be unique.
+ *
+ * Rather than calling the generic functions directly most users will
+ * want to generate type safe wrappers using
+ * RBTREE_DECLARE_INLINE_WRAPPERS().
+ *
+ * No form of internal locking or other thread-safety is provided.
+ *
+ * @{
+ */
+
+typedef struct rbtree_node {
+	bintree_node_t bintree;
+	bool red;
+} rbtree_node_t;
+#define RBTREE_NODE_VAR_INIT { BINTREE_NODE_VAR_INIT, false }
+
+typedef struct {
+	bintree_node_t *root;
+} rbtree_t;
+#define RBTREE_VAR_INIT { 0 }
+
+/*!
+ * \brief Stack depth sufficient for the stack based bintree iterators.
+ *
+ * The height of a red-black tree with n nodes is at most 2 * log2(n + 1)
+ * and n cannot exceed the size of the address space.
+ */
+#define RBTREE_MAX_DEPTH (2 * 8 * sizeof(void *))
+
+/*!
+ * \brief Compare a key against the key of a node.
+ *
+ * Returns a value less than, equal to or greater than zero if key is
+ * less than, equal to or greater than the key of node.
+ */
+typedef int rbtree_key_compare_t(const void *key, rbtree_node_t *node);
+
+static inline rbtree_node_t *rbtree_from_bintree(bintree_node_t *node)
+{
+	return node ? containerof(node, rbtree_node_t, bintree) : NULL;
+}
+
+static inline bool rbtree_empty(rbtree_t *tree)
+{
+	return !tree->root;
+}
+
+/*!
+ * \brief Insert a node into the tree.
+ *
+ * key must be the key of node (in practice it is usually a pointer to a
+ * member of the structure node is embedded in).
+ *
+ * \returns NULL if the node was inserted or the node already present with
+ *          the same key (in which case the tree keeps the existing node).
+ */
+rbtree_node_t *rbtree_insert(rbtree_t *tree, rbtree_node_t *node,
+			     const void *key, rbtree_key_compare_t *keycmp);
+
+/*!
+ * \brief Remove the node matching key from the tree.
+ *
+ * \returns The node removed or NULL if there is no node matching key.
+ */
+rbtree_node_t *rbtree_remove(rbtree_t *tree, const void *key,
+			     rbtree_key_compare_t *keycmp);
+
+/*! \brief Find the node matching key (or NULL if there is no match). */
+rbtree_node_t *rbtree_find(rbtree_t *tree, const void *key,
+			   rbtree_key_compare_t *keycmp);
+
+/*! \brief Find the first node whose key is not less than key. */
+rbtree_node_t *rbtree_lower_bound(rbtree_t *tree, const void *key,
+				  rbtree_key_compare_t *keycmp);
+
+/*! \brief Find the first node whose key is greater than key. */
+rbtree_node_t *rbtree_upper_bound(rbtree_t *tree, const void *key,
+				  rbtree_key_compare_t *keycmp);
+
+/*! \brief Find the node with the smallest key. */
+rbtree_node_t *rbtree_first(rbtree_t *tree);
+
+/*! \brief Find the node with the largest key. */
+rbtree_node_t *rbtree_last(rbtree_t *tree);
+
+/*!
+ * \brief Three-way comparison suitable for integer and pointer keys.
+ *
+ * Can be used as the keycmp argument of RBTREE_DECLARE_INLINE_WRAPPERS().
+ */
+#define RBTREE_SCALAR_COMPARE(a, b) (((a) > (b)) - ((a) < (b)))
+
+/*!
+ * \brief Generate type safe wrappers for an ordered map.
+ *
+ * \param prefix   Prefix for the generated functions.
+ * \param type     Structure that embeds the tree node.
+ * \param member   Name of the rbtree_node_t within type.
+ * \param key_type Type of the key.
+ * \param key      Name of the key within type.
+ * \param keycmp   Function (or function-like macro) taking two key_type
+ *                 values and returning a three-way comparison, such as
+ *                 RBTREE_SCALAR_COMPARE or strcmp.
+ *
+ * prefix_next() performs a search from the root of the tree so it is
+ * O(log n). It is safe to use even if the tree is modified between calls.
+ * bintree_iterate_in_order_stack() is cheaper when the whole tree is to be
+ * visited without modification.
+ */
+#define RBTREE_DECLARE_INLINE_WRAPPERS(prefix, type, member, key_type, key,    \
+				       keycmp)                                 \
+	static inline type *prefix##_from_rbtree(rbtree_node_t *node)          \
+	{                                                                      \
+		return node ? containerof(node, type, member) : NULL;          \
+	}                                                                      \
+                                                                               \
+	static inline int prefix##_keycmp(const void *k, rbtree_node_t *node)  \
+	{                                                                      \
+		return keycmp(*(const key_type *) k,                           \
+			      prefix##_from_rbtree(node)->key);                \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_insert(rbtree_t *tree, type *node)        \
+	{                                                                      \
+		return prefix##_from_rbtree(rbtree_insert(                     \
+		    tree, &node->member, &node->key, prefix##_keycmp));        \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_remove(rbtree_t *tree, key_type k)        \
+	{                                                                      \
+		return prefix##_from_rbtree(                                   \
+		    rbtree_remove(tree, &k, prefix##_keycmp));                 \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_find(rbtree_t *tree, key_type k)          \
+	{                                                                      \
+		return prefix##_from_rbtree(                                   \
+		    rbtree_find(tree, &k, prefix##_keycmp));                   \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_lower_bound(rbtree_t *tree, key_type k)   \
+	{                                                                      \
+		return prefix##_from_rbtree(                                   \
+		    rbtree_lower_bound(tree, &k, prefix##_keycmp));            \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_upper_bound(rbtree_t *tree, key_type k)   \
+	{                                                                      \
+		return prefix##_from_rbtree(                                   \
+		    rbtree_upper_bound(tree, &k, prefix##_keycmp));            \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_first(rbtree_t *tree)                     \
+	{                                                                      \
+		return prefix##_from_rbtree(rbtree_first(tree));               \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_last(rbtree_t *tree)                      \
+	{                                                                      \
+		return prefix##_from_rbtree(rbtree_last(tree));                \
+	}                                                                      \
+                                                                               \
+	static inline type *prefix##_next(rbtree_t *tree, type *node)          \
+	{                                                                      \
+		return prefix##_upper_bound(tree, node->key);                  \
+	}
+
+/*! @} */
+#endif // RF_RBTREE_H_
@@ -0,0 +1,112 @@
+/*
+ * recordq.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_RECORDQ_H_
+#define RF_RECORDQ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+/*!
+ * \defgroup librfn_recordq Variable length record queue
+ *
+ * \brief Lockless zero-copy queue of variable length records.
+ *
+ * Records are stored contiguously in a byte buffer, each preceded by a
+ * small length header. The sender reserves space for a record, fills it in
+ * place and commits it. The receiver reads the record directly from the
+ * buffer and releases it when it is finished. A record that does not fit
+ * in the space remaining at the end of the buffer is placed at the start
+ * instead (the unused tail of the buffer is skipped) so records are never
+ * split.
+ *
+ * Records are aligned to RECORDQ_ALIGN bytes, the buffer must be aligned
+ * to the same boundary and its usable length is rounded down to a multiple
+ * of it.
+ *
+ * The record queue is thread safe (and SMP safe) only for one-to-one
+ * messaging. It cannot be used with multiple sender threads nor multiple
+ * receiver threads without additional locking.
+ *
+ * @{
+ */
+
+#define RECORDQ_ALIGN sizeof(uint32_t)
+
+/*!
+ * \brief Record queue descriptor.
+ */
+typedef struct {
+	char *basep;
+	uint32_t buf_len;
+	atomic_uint readp;
+	atomic_uint writep;
+} recordq_t;
+
+/*!
+ * \brief Static initializer for a record queue descriptor.
+ */
+#define RECORDQ_VAR_INIT(basep, buf_len) \
+	{ \
+		(char *) (basep), \
+		(buf_len) & ~(RECORDQ_ALIGN - 1), \
+		ATOMIC_VAR_INIT(0), \
+		ATOMIC_VAR_INIT(0) \
+	}
+
+void recordq_init(recordq_t *q, void *basep, size_t buf_len);
+
+/*!
+ * \brief Reserve space for a record of up to len bytes.
+ *
+ * The record is not visible to the receiver until it is committed. Only
+ * one reservation may be outstanding at once.
+ *
+ * \returns Pointer to the record or NULL if there is not enough space.
+ */
+void *recordq_reserve(recordq_t *q, size_t len);
+
+/*!
+ * \brief Commit a reserved record.
+ *
+ * len may be smaller than the length originally reserved (in which case
+ * the unused space is returned to the queue). Committing a zero length
+ * record abandons the reservation.
+ */
+void recordq_commit(recordq_t *q, void *rec, size_t len);
+
+/*!
+ * \brief Get the oldest committed record.
+ *
+ * \param len Updated with the length of the record
+ *
+ * \returns Pointer to the record or NULL if the queue is empty.
+ */
+void *recordq_peek(recordq_t *q, size_t *len);
+
+/*!
+ * \brief Release a record obtained with recordq_peek().
+ */
+void recordq_release(recordq_t *q, void *rec);
+
+static inline bool recordq_empty(recordq_t *q)
+{
+	return atomic_load_explicit(&q->readp, memory_order_relaxed) ==
+	       atomic_load_explicit(&q->writep, memory_order_relaxed);
+}
+
+/*! @} */
+#endif // RF_RECORDQ_H_
@@ -77,6 +77,42 @@ bool ringbuf_empty(ringbuf_t *rb);
  */
 bool ringbuf_put(ringbuf_t *rb, uint8_t d);
 
+/*!
+ * \brief Copy a block of data into the ring buffer.
+ *
+ * \returns The number of bytes written, which is less than n if the ring
+ *          buffer became full.
+ */
+size_t ringbuf_write(ringbuf_t *rb, const void *p, size_t n);
+
+/*!
+ * \brief Copy a block of data out of the ring buffer.
+ *
+ * \returns The number of bytes read, which is less than n if the ring
+ *          buffer became empty.
+ */
+size_t ringbuf_read(ringbuf_t *rb, void *p, size_t n);
+
+/*!
+ * \brief Get the longest contiguous block of data in the ring buffer.
+ *
+ * The data remains in the ring buffer until it is discarded with
+ * ringbuf_consume(). Together these functions allow the consumer to hand
+ * data directly to a DMA or USB engine without copying it.
+ *
+ * \param n Updated with the number of bytes available (zero if the ring
+ *          buffer is empty).
+ * \returns Pointer to the first byte.
+ */
+uint8_t *ringbuf_peek_contig(ringbuf_t *rb, size_t *n);
+
+/*!
+ * \brief Discard bytes from the ring buffer.
+ *
+ * n must not be greater than the number of bytes available.
+ */
+void ringbuf_consume(ringbuf_t *rb, size_t n);
+
 /*!
  * \brief Insert a character into the ring buffer.
  *
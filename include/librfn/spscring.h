@@ -0,0 +1,115 @@
+/*
+ * spscring.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_SPSCRING_H_
+#define RF_SPSCRING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+/*!
+ * \defgroup librfn_spscring High throughput ring buffer
+ *
+ * \brief Lockless single-producer/single-consumer byte ring optimized for
+ *        SMP.
+ *
+ * This is a drop-in alternative to the \ref librfn_ringbuf "ring buffer"
+ * for data passed between CPUs at high rates:
+ *
+ *  - The buffer length must be a power of two. The indices are free-running
+ *    and are masked when the buffer is accessed, so every byte of the
+ *    buffer can be used and no compare-and-subtract is needed.
+ *  - The producer and consumer indices live on separate cache lines. Each
+ *    side also caches the last value it read of the other side's index and
+ *    only re-reads it when the cached copy suggests the ring is full (or
+ *    empty). The two CPUs therefore rarely share a cache line.
+ *  - The indices are published with release stores and read with acquire
+ *    loads. No sequentially consistent operations are required.
+ *
+ * The price is a larger descriptor, which makes the \ref librfn_ringbuf
+ * "ring buffer" a better choice for small microcontroller systems.
+ *
+ * The ring is thread safe (and SMP safe) only for one-to-one messaging.
+ *
+ * @{
+ */
+
+/*!
+ * \brief High throughput ring descriptor.
+ */
+typedef struct {
+	uint8_t *bufp;
+	uint32_t mask;
+
+	/* written by the producer */
+	atomic_uint writei __attribute__((aligned(CONFIG_CACHE_LINE_SIZE)));
+	uint32_t cached_readi;
+
+	/* written by the consumer */
+	atomic_uint readi __attribute__((aligned(CONFIG_CACHE_LINE_SIZE)));
+	uint32_t cached_writei;
+} spscring_t;
+
+/*!
+ * \brief Static initializer for a ring descriptor.
+ *
+ * buf_len must be a power of two.
+ */
+#define SPSCRING_VAR_INIT(bufp, buf_len) \
+	{ \
+		(uint8_t *) (bufp), \
+		(buf_len) - 1, \
+		ATOMIC_VAR_INIT(0), \
+		0, \
+		ATOMIC_VAR_INIT(0), \
+		0 \
+	}
+
+void spscring_init(spscring_t *rb, void *bufp, size_t buf_len);
+
+/*!
+ * \brief Extract a byte from the ring.
+ *
+ * \returns Unsigned byte on success, otherwise -1.
+ */
+int spscring_get(spscring_t *rb);
+
+/*!
+ * \brief Insert a byte into the ring.
+ */
+bool spscring_put(spscring_t *rb, uint8_t d);
+
+/*!
+ * \brief Test whether the ring contains any data.
+ */
+bool spscring_empty(spscring_t *rb);
+
+/*!
+ * \brief Copy a block of data into the ring.
+ *
+ * \returns The number of bytes written.
+ */
+size_t spscring_write(spscring_t *rb, const void *p, size_t n);
+
+/*!
+ * \brief Copy a block of data out of the ring.
+ *
+ * \returns The number of bytes read.
+ */
+size_t spscring_read(spscring_t *rb, void *p, size_t n);
+
+/*! @} */
+#endif // RF_SPSCRING_H_
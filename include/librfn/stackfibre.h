@@ -0,0 +1,124 @@
+/*
+ * stackfibre.h
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef RF_STACKFIBRE_H_
+#define RF_STACKFIBRE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fibre.h"
+
+/*!
+ * \defgroup librfn_stackfibre Stackful fibre
+ *
+ * \brief Fibres with their own stack, scheduled alongside protothreads.
+ *
+ * A stackful fibre is an ordinary fibre whose entry point switches to a
+ * private stack. This allows local variables to survive across a yield and
+ * allows functions at any depth of the call chain to block without
+ * resorting to PT_SPAWN(). Stackful fibres share the run queue and timer
+ * queue with protothreads and can be woken using fibre_run().
+ *
+ * Stacks are guard-paged (so an overflow faults rather than silently
+ * corrupting memory) and are recycled through a pool. A stack is only
+ * allocated whilst the fibre is executing its entry point. Killing a
+ * stackful fibre with fibre_kill() abandons its call chain and returns the
+ * stack to the pool; if the fibre is run again it restarts from its entry
+ * point.
+ *
+ * When the SMP scheduler is enabled a suspended stackful fibre may be
+ * resumed by a different worker thread. This is supported but the
+ * compiler is free to cache the address of thread-local variables
+ * (including errno) across a call, so such addresses must not be relied
+ * upon across a yield or wait.
+ *
+ * The price for this convenience is memory (each active fibre needs a
+ * whole stack) and a more expensive context switch.
+ *
+ * \note Only available on POSIX hosts that provide ucontext and requires
+ *       CONFIG_FIBRE_JOIN.
+ *
+ * @{
+ */
+
+/*!
+ * \brief Size of each stack (excluding the guard page).
+ */
+#ifndef CONFIG_STACKFIBRE_STACK_SIZE
+#define CONFIG_STACKFIBRE_STACK_SIZE (64 * 1024)
+#endif
+
+typedef void stackfibre_entrypoint_t(void *arg);
+
+struct stackfibre_stack;
+
+typedef struct {
+	fibre_t fibre;
+	stackfibre_entrypoint_t *fn;
+	void *arg;
+	struct stackfibre_stack *stack;
+} stackfibre_t;
+
+/*!
+ * \private
+ */
+int stackfibre_trampoline(fibre_t *f);
+
+/*!
+ * \brief Static initializer for a stackful fibre.
+ */
+#define STACKFIBRE_VAR_INIT(entrypoint, argument) \
+	{ \
+		.fibre = FIBRE_VAR_INIT(stackfibre_trampoline), \
+		.fn = (entrypoint), \
+		.arg = (argument) \
+	}
+
+void stackfibre_init(stackfibre_t *sf, stackfibre_entrypoint_t *fn,
+		     void *arg);
+
+/*!
+ * \brief Yield to any other runnable fibre.
+ *
+ * The stackful equivalent of PT_YIELD().
+ */
+void stackfibre_yield(void);
+
+/*!
+ * \brief Sleep until woken by fibre_run() (or by a timer).
+ *
+ * The stackful equivalent of PT_WAIT().
+ */
+void stackfibre_wait(void);
+
+/*!
+ * \brief Sleep until a condition is true.
+ *
+ * The stackful equivalent of PT_WAIT_UNTIL(). Like its protothread
+ * counterpart the condition is re-evaluated each time the fibre is run
+ * so it can be used with fibre_timeout() and fibre_wait_fd().
+ */
+#define STACKFIBRE_WAIT_UNTIL(c) \
+	do { \
+		while (!(c)) \
+			stackfibre_wait(); \
+	} while (0)
+
+/*!
+ * \brief Sleep until a timeout is reached.
+ */
+void stackfibre_sleep(uint32_t duetime);
+
+/*! @} */
+#endif // RF_STACKFIBRE_H_
@@ -13,6 +13,7 @@
 
 #include "librfn/bintree.h"
 
+#include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -168,6 +169,7 @@ bintree_node_t *bintree_iterate_in_order(bintree_iterator_t *iter,
 {
 	iter->next = in_order_iterator;
 	iter->curr = tree;
+	iter->stack = NULL;
 	return in_order_iterator(iter);
 }
 
@@ -215,6 +217,7 @@ bintree_node_t *bintree_iterate_list(bintree_iterator_t *iter,
 				     bintree_is_list_t *is_list)
 {
 	iter->filter = is_list;
+	iter->stack = NULL;
 
 	if (is_list(tree) && tree->left && is_list(tree->left)) {
 		iter->next = list_left_iterator;
@@ -351,9 +354,130 @@ bintree_node_t *bintree_iterate_pre_order(bintree_iterator_t *iter,
 {
 	iter->next = pre_order_iterator;
 	iter->curr = tree;
+	iter->stack = NULL;
 	return pre_order_iterator(iter);
 }
 
+/*
+ * The stack based iterators record the path from the root in iter->stack
+ * rather than threading the tree. iter->depth is the number of entries in
+ * use.
+ */
+
+static inline void push(bintree_iterator_t *iter, bintree_node_t *node)
+{
+	assert(iter->depth < iter->max_depth);
+	iter->stack[iter->depth++] = node;
+}
+
+static inline bintree_node_t *pop(bintree_iterator_t *iter)
+{
+	return iter->depth ? iter->stack[--iter->depth] : NULL;
+}
+
+static void push_left(bintree_iterator_t *iter, bintree_node_t *node)
+{
+	for (; node; node = node->left)
+		push(iter, node);
+}
+
+static bintree_node_t *in_order_stack_iterator(bintree_iterator_t *iter)
+{
+	bintree_node_t *node = pop(iter);
+
+	if (node)
+		push_left(iter, node->right);
+
+	return node;
+}
+
+bintree_node_t *bintree_iterate_in_order_stack(bintree_iterator_t *iter,
+					       bintree_node_t *tree,
+					       bintree_node_t **stack,
+					       unsigned int max_depth)
+{
+	iter->next = in_order_stack_iterator;
+	iter->stack = stack;
+	iter->depth = 0;
+	iter->max_depth = max_depth;
+	push_left(iter, tree);
+	return in_order_stack_iterator(iter);
+}
+
+/* descend to the first node, in post-order, of the sub-tree */
+static void push_first_post_order(bintree_iterator_t *iter,
+				  bintree_node_t *node)
+{
+	while (node) {
+		push(iter, node);
+		node = node->left ? node->left : node->right;
+	}
+}
+
+static bintree_node_t *post_order_stack_iterator(bintree_iterator_t *iter)
+{
+	bintree_node_t *node = pop(iter);
+
+	if (!node)
+		return NULL;
+
+	/*
+	 * If we came up from the left then the right sub-tree must be visited
+	 * before the parent. This must be done before returning because the
+	 * caller is permitted to free the node.
+	 */
+	iter->parent = iter->depth ? iter->stack[iter->depth - 1] : NULL;
+	if (iter->parent && iter->parent->left == node)
+		push_first_post_order(iter, iter->parent->right);
+
+	return node;
+}
+
+bintree_node_t *bintree_iterate_post_order_stack(bintree_iterator_t *iter,
+						 bintree_node_t *tree,
+						 bintree_node_t **stack,
+						 unsigned int max_depth)
+{
+	iter->next = post_order_stack_iterator;
+	iter->stack = stack;
+	iter->depth = 0;
+	iter->max_depth = max_depth;
+	push_first_post_order(iter, tree);
+	return post_order_stack_iterator(iter);
+}
+
+/*
+ * iter->curr is the next node to visit and the stack holds only the right
+ * children that are waiting for a left sub-tree to be visited. This keeps
+ * the stack no deeper than the tree.
+ */
+static bintree_node_t *pre_order_stack_iterator(bintree_iterator_t *iter)
+{
+	bintree_node_t *node = iter->curr ? iter->curr : pop(iter);
+
+	if (!node)
+		return NULL;
+
+	if (node->left && node->right)
+		push(iter, node->right);
+	iter->curr = node->left ? node->left : node->right;
+
+	return node;
+}
+
+bintree_node_t *bintree_iterate_pre_order_stack(bintree_iterator_t *iter,
+						bintree_node_t *tree,
+						bintree_node_t **stack,
+						unsigned int max_depth)
+{
+	iter->next = pre_order_stack_iterator;
+	iter->curr = tree;
+	iter->stack = stack;
+	iter->depth = 0;
+	iter->max_depth = max_depth;
+	return pre_order_stack_iterator(iter);
+}
+
 struct visualize {
 	FILE *f;
 	bintree_labeller_t *labeller;
@@ -31,6 +31,16 @@ static pt_state_t console_echo(console_t *c)
 static const console_cmd_t cmd_echo =
     CONSOLE_CMD_VAR_INIT("echo", console_echo);
 
+#if !defined(CONFIG_NO_FIBRE) && defined(CONFIG_FIBRE_STATS)
+static pt_state_t console_fibres(console_t *c)
+{
+	fibre_stats_dump(c->out);
+	return PT_EXITED;
+}
+static const console_cmd_t cmd_fibres =
+    CONSOLE_CMD_VAR_INIT("fibres", console_fibres);
+#endif
+
 static pt_state_t console_help(console_t *c);
 static const console_cmd_t cmd_help =
     CONSOLE_CMD_VAR_INIT("help", console_help);
@@ -46,6 +56,9 @@ static const console_cmd_t cmd_unknown =
 
 static const console_cmd_t *cmd_table[32] = {
 	&cmd_echo,
+#if !defined(CONFIG_NO_FIBRE) && defined(CONFIG_FIBRE_STATS)
+	&cmd_fibres,
+#endif
 	&cmd_help,
 	&cmd_unknown
 };
@@ -200,9 +213,8 @@ pt_state_t console_eval(pt_t *pt, console_t *c, const char *cmd)
 	PT_BEGIN(pt);
 
 	for (*i=0; cmd[*i]; ) {
-		if (ringbuf_put(&c->ring, cmd[*i])) {
-			*i += 1;
-		} else {
+		*i += ringbuf_write(&c->ring, cmd + *i, strlen(cmd + *i));
+		if (cmd[*i]) {
 #ifndef CONFIG_NO_FIBRE
 			fibre_run(&c->fibre);
 #endif
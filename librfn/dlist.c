@@ -0,0 +1,130 @@
+/*
+ * dlist.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "librfn/dlist.h"
+
+void dlist_insert(dlist_t *list, dlist_node_t *node)
+{
+	assert(!node->next && !node->prev && list->head != node);
+
+	node->prev = list->tail;
+	if (list->tail)
+		list->tail->next = node;
+	else
+		list->head = node;
+	list->tail = node;
+}
+
+void dlist_push(dlist_t *list, dlist_node_t *node)
+{
+	assert(!node->next && !node->prev && list->head != node);
+
+	node->next = list->head;
+	if (list->head)
+		list->head->prev = node;
+	else
+		list->tail = node;
+	list->head = node;
+}
+
+void dlist_insert_before(dlist_t *list, dlist_node_t *pos,
+			 dlist_node_t *node)
+{
+	assert(!node->next && !node->prev);
+
+	node->next = pos;
+	node->prev = pos->prev;
+	if (pos->prev)
+		pos->prev->next = node;
+	else
+		list->head = node;
+	pos->prev = node;
+}
+
+void dlist_insert_after(dlist_t *list, dlist_node_t *pos, dlist_node_t *node)
+{
+	assert(!node->next && !node->prev);
+
+	node->prev = pos;
+	node->next = pos->next;
+	if (pos->next)
+		pos->next->prev = node;
+	else
+		list->tail = node;
+	pos->next = node;
+}
+
+void dlist_splice(dlist_t *list, dlist_t *src)
+{
+	if (!src->head)
+		return;
+
+	if (list->tail) {
+		list->tail->next = src->head;
+		src->head->prev = list->tail;
+	} else {
+		list->head = src->head;
+	}
+	list->tail = src->tail;
+
+	src->head = src->tail = NULL;
+}
+
+dlist_node_t *dlist_extract(dlist_t *list)
+{
+	dlist_node_t *node = list->head;
+
+	if (node)
+		dlist_remove(list, node);
+
+	return node;
+}
+
+dlist_node_t *dlist_extract_tail(dlist_t *list)
+{
+	dlist_node_t *node = list->tail;
+
+	if (node)
+		dlist_remove(list, node);
+
+	return node;
+}
+
+void dlist_remove(dlist_t *list, dlist_node_t *node)
+{
+	if (node->prev)
+		node->prev->next = node->next;
+	else
+		list->head = node->next;
+
+	if (node->next)
+		node->next->prev = node->prev;
+	else
+		list->tail = node->prev;
+
+	/* invalidate the link pointers */
+	node->next = node->prev = NULL;
+}
+
+bool dlist_contains(dlist_t *list, dlist_node_t *node)
+{
+	for (dlist_node_t *curr = list->head; curr; curr = curr->next)
+		if (curr == node)
+			return true;
+
+	return false;
+}
@@ -0,0 +1,111 @@
+/*
+ * elemring.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/elemring.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * The indices are element numbers and, as with ringbuf_t, the memory
+ * ordering pairs the owner's release store with the other side's acquire
+ * load.
+ */
+
+void elemring_init(elemring_t *r, void *basep, size_t base_len,
+		   size_t elem_size)
+{
+	memset(r, 0, sizeof(*r));
+
+	r->basep = basep;
+	r->elem_size = elem_size;
+	r->num_elems = base_len / elem_size;
+}
+
+static inline char *elem(elemring_t *r, unsigned int i)
+{
+	return r->basep + (i * r->elem_size);
+}
+
+static inline unsigned int advance(elemring_t *r, unsigned int i,
+				   unsigned int n)
+{
+	i += n;
+	if (i >= r->num_elems)
+		i -= r->num_elems;
+	return i;
+}
+
+bool elemring_push(elemring_t *r, const void *e)
+{
+	return 1 == elemring_push_n(r, e, 1);
+}
+
+bool elemring_pop(elemring_t *r, void *e)
+{
+	return 1 == elemring_pop_n(r, e, 1);
+}
+
+size_t elemring_push_n(elemring_t *r, const void *elems, size_t n)
+{
+	unsigned int writei =
+	    atomic_load_explicit(&r->writei, memory_order_relaxed);
+	unsigned int readi =
+	    atomic_load_explicit(&r->readi, memory_order_acquire);
+	const char *src = elems;
+
+	assert(writei < r->num_elems);
+
+	size_t space = (readi > writei ? readi : readi + r->num_elems) -
+		       writei - 1;
+	if (n > space)
+		n = space;
+
+	size_t first = r->num_elems - writei;
+	if (first > n)
+		first = n;
+	memcpy(elem(r, writei), src, first * r->elem_size);
+	memcpy(elem(r, 0), src + (first * r->elem_size),
+	       (n - first) * r->elem_size);
+
+	atomic_store_explicit(&r->writei, advance(r, writei, n),
+			      memory_order_release);
+	return n;
+}
+
+size_t elemring_pop_n(elemring_t *r, void *elems, size_t n)
+{
+	unsigned int readi =
+	    atomic_load_explicit(&r->readi, memory_order_relaxed);
+	unsigned int writei =
+	    atomic_load_explicit(&r->writei, memory_order_acquire);
+	char *dst = elems;
+
+	assert(readi < r->num_elems);
+
+	size_t avail = (writei >= readi ? writei : writei + r->num_elems) -
+		       readi;
+	if (n > avail)
+		n = avail;
+
+	size_t first = r->num_elems - readi;
+	if (first > n)
+		first = n;
+	memcpy(dst, elem(r, readi), first * r->elem_size);
+	memcpy(dst + (first * r->elem_size), elem(r, 0),
+	       (n - first) * r->elem_size);
+
+	atomic_store_explicit(&r->readi, advance(r, readi, n),
+			      memory_order_release);
+	return n;
+}
@@ -14,79 +14,438 @@
 #include "librfn/fibre.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdint.h>
+#ifdef CONFIG_FIBRE_STATS
+#include <stdio.h>
+#endif
 #include <stdlib.h>
 #include <string.h>
 
 #include "librfn/atomic.h"
+#include "librfn/bitops.h"
+#include "librfn/dlist.h"
+#include "librfn/heap.h"
 #include "librfn/list.h"
 #include "librfn/messageq.h"
+#include "librfn/mlog.h"
+#include "librfn/time.h"
 #include "librfn/util.h"
 
-static fibre_t *atomic_runq_buf[8];
+#if CONFIG_FIBRE_PRIORITIES > 32
+#error CONFIG_FIBRE_PRIORITIES is too large
+#endif
 
-static struct {
+static int duetime_cmp(heap_node_t *n1, heap_node_t *n2);
+
+struct fibre_kernel {
 	fibre_t *current;
 	fibre_state_t state;
 	uint32_t now;
 
-	list_t runq;
-	messageq_t atomic_runq;
-	list_t timerq;
-
-	atomic_uint taint_flags;
-} kernel = {
-	.runq = LIST_VAR_INIT,
-	.atomic_runq = MESSAGEQ_VAR_INIT(
-			atomic_runq_buf,
-			sizeof(atomic_runq_buf), sizeof(atomic_runq_buf[0])),
-	.timerq = LIST_VAR_INIT
+	uint32_t runq_bitmap;
+	dlist_t runq[CONFIG_FIBRE_PRIORITIES];
+	fibre_t *_Atomic wakeq;
+	heap_t timerq;
+
+	fibre_wakeup_t *wakeup;
+	void *wakeup_ctx;
+	atomic_uchar sleeping;
+
+	uint32_t passes;
+	uint32_t fast_path;
+
+#ifdef CONFIG_FIBRE_SMP
+	unsigned int id;
+#endif
 };
 
+static struct fibre_kernel boot_kernel = {
+	.timerq = HEAP_VAR_INIT(duetime_cmp)
+};
+
+static atomic_uint taint_flags;
+static atomic_uint taint_events;
+
+#ifdef CONFIG_FIBRE_STATS
+/* all fibres that have statistics attached (for fibre_stats_dump()) */
+static list_t stats_list;
+#endif
+
+/* watchdog limits in microseconds (zero disables the check) */
+static uint32_t watchdog_run_budget;
+static uint32_t watchdog_late_budget;
+
+#ifdef CONFIG_FIBRE_SMP
+/*
+ * Each worker thread has a private kernel. Threads that have not attached
+ * themselves as a worker share the boot kernel (although only one of them
+ * may call fibre_scheduler_next() and only that thread may use the
+ * functions that are not atomic).
+ */
+static __thread struct fibre_kernel *this_kernel = &boot_kernel;
+#define kernel (*this_kernel)
+
+static struct fibre_kernel *workers[32] = { &boot_kernel };
+static atomic_uint num_workers = ATOMIC_VAR_INIT(1);
+
+/* bitmap of workers that are waiting for another worker to give them work */
+static atomic_uint idle_workers;
+#else
+#define kernel boot_kernel
+#endif
+
+static void fd_withdraw(fibre_t *f)
+{
+#ifdef CONFIG_FIBRE_WAIT_FD
+	if (f->wait_fd)
+		fibre_wait_fd_withdraw(f);
+#else
+	(void) f;
+#endif
+}
+
+static void runq_insert(fibre_t *f)
+{
+	/* a runnable fibre registers again if it still wants to wait */
+	fd_withdraw(f);
+
+	dlist_insert(&kernel.runq[f->priority], &f->link);
+	kernel.runq_bitmap |= 1 << f->priority;
+	f->state = FIBRE_STATE_RUNNABLE;
+}
+
+static void runq_remove(fibre_t *f)
+{
+	dlist_t *runq = &kernel.runq[f->priority];
+
+	dlist_remove(runq, &f->link);
+	if (dlist_empty(runq))
+		kernel.runq_bitmap &= ~(1 << f->priority);
+}
+
+static fibre_stats_t *get_stats(fibre_t *f)
+{
+#ifdef CONFIG_FIBRE_STATS
+	return f->stats;
+#else
+	(void) f;
+	return NULL;
+#endif
+}
+
+static void stats_wake(fibre_stats_t *stats, uint32_t woken)
+{
+	stats->woken = woken;
+	stats->waking = true;
+}
+
+static void stats_begin(fibre_stats_t *stats, uint32_t start)
+{
+	stats->runs++;
+	if (stats->waking) {
+		uint32_t latency = start - stats->woken;
+
+		stats->waking = false;
+		stats->wakes++;
+		stats->total_latency += latency;
+		if (latency > stats->max_latency)
+			stats->max_latency = latency;
+	}
+}
+
+static void stats_end(fibre_stats_t *stats, uint32_t run_time)
+{
+	stats->total_run_time += run_time;
+	if (run_time > stats->max_run_time)
+		stats->max_run_time = run_time;
+}
+
 static void add_taint(char id)
 {
 	id -= 'A';
-	assert(id < 8*sizeof(kernel.taint_flags));
-	atomic_fetch_or(&kernel.taint_flags, 1 << id);
+	assert(id < 8*sizeof(taint_flags));
+	atomic_fetch_or(&taint_flags, 1 << id);
+	atomic_fetch_add(&taint_events, 1);
 }
 
-static void handle_atomic_runq(void)
+/*
+ * Push a fibre onto a kernel's wake queue. This is an intrusive lock-free
+ * stack; the pending flag guarantees that a fibre is never on the stack
+ * more than once so pushing can never fail (and a burst of wake ups for a
+ * fibre that is already pending coalesces into a single entry).
+ */
+static void post_atomic(struct fibre_kernel *k, fibre_t *f)
+{
+	/*
+	 * The caller has usually just written the condition the fibre is
+	 * waiting for. That store must be ordered before we read
+	 * wake_pending, otherwise we could skip the push because a stale
+	 * pending flag is set whilst the fibre (having been dequeued) reads
+	 * the stale condition. This pairs with the fence in
+	 * handle_atomic_runq().
+	 */
+	if (atomic_exchange_explicit(&f->wake_pending, 1, memory_order_seq_cst))
+		return;
+
+	fibre_t *head = atomic_load_explicit(&k->wakeq, memory_order_relaxed);
+	do {
+		f->wake_next = head;
+	} while (!atomic_compare_exchange_weak_explicit(&k->wakeq, &head, f,
+							memory_order_release,
+							memory_order_relaxed));
+
+	/*
+	 * Pairs with the fence in fibre_scheduler_sleep_begin(); either we
+	 * see the sleeping flag or the scheduler sees our wake up.
+	 */
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&k->sleeping, memory_order_relaxed) &&
+	    atomic_exchange(&k->sleeping, 0))
+		k->wakeup(k->wakeup_ctx);
+}
+
+#ifdef CONFIG_FIBRE_SMP
+/*
+ * Find the kernel that owns a fibre. Fibres that have never been run are
+ * adopted by the calling thread's kernel.
+ */
+static struct fibre_kernel *get_owner(fibre_t *f)
+{
+	struct fibre_kernel *owner =
+	    atomic_load_explicit(&f->owner, memory_order_relaxed);
+
+	if (!owner && !atomic_compare_exchange_strong(&f->owner, &owner,
+						      &kernel))
+		return owner;
+
+	return owner ? owner : &kernel;
+}
+
+static void give_work(struct fibre_kernel *idler)
+{
+	/* lowest priority work is given away first */
+	int priority = ctz(kernel.runq_bitmap);
+	dlist_t *runq = &kernel.runq[priority];
+	fibre_t *f = containerof(dlist_extract(runq), fibre_t, link);
+	if (dlist_empty(runq))
+		kernel.runq_bitmap &= ~(1 << priority);
+
+	f->state = FIBRE_STATE_WAITING;
+	atomic_store(&f->owner, idler);
+	post_atomic(idler, f);
+}
+
+/*
+ * Hand any spare runnable fibres over to idle workers. We only get here
+ * after kernel.current has been extracted from the run queue so anything
+ * left on the run queue is spare.
+ */
+static void share_work(void)
 {
-	fibre_t **f;
+	uint32_t self = 1 << kernel.id;
+	uint32_t idle =
+	    atomic_load_explicit(&idle_workers, memory_order_relaxed) & ~self;
 
-	while (NULL != (f = messageq_receive(&kernel.atomic_runq))) {
-		fibre_run(*f);
-		messageq_release(&kernel.atomic_runq, f);
+	while (idle && kernel.runq_bitmap) {
+		uint32_t mask = 1 << ctz(idle);
+		uint32_t prev = atomic_fetch_and(&idle_workers, ~mask);
+
+		/* only give work if we were the one to clear the idle bit */
+		if (prev & mask)
+			give_work(workers[ctz(mask)]);
+
+		idle = prev & ~mask & ~self;
 	}
 }
 
-static void handle_timerq(void)
+static void update_idle(bool idle)
 {
-	list_iterator_t iter;
+	uint32_t mask = 1 << kernel.id;
+	uint32_t prev =
+	    atomic_load_explicit(&idle_workers, memory_order_relaxed);
+
+	if (idle && !(prev & mask))
+		atomic_fetch_or(&idle_workers, mask);
+	else if (!idle && (prev & mask))
+		atomic_fetch_and(&idle_workers, ~mask);
+}
+#endif
+
+static void wake(fibre_t *f);
+
+static void handle_atomic_runq(void)
+{
+	if (!atomic_load_explicit(&kernel.wakeq, memory_order_relaxed))
+		return;
+
+	/* take the whole stack in one go and reverse it to get FIFO order */
+	fibre_t *f = atomic_exchange_explicit(&kernel.wakeq, NULL,
+					      memory_order_acquire);
+	fibre_t *batch = NULL;
+	while (f) {
+		fibre_t *next = f->wake_next;
+		f->wake_next = batch;
+		batch = f;
+		f = next;
+	}
 
-	list_node_t *node = list_iterate(&kernel.timerq, &iter);
-	fibre_t *timeout_fibre = containerof(node, fibre_t, link);
-	while (NULL != node &&
-			cyclecmp32(timeout_fibre->duetime, kernel.now) <= 0) {
-		node = list_iterator_remove(&iter);
-		list_insert(&kernel.runq, &timeout_fibre->link);
-		timeout_fibre = containerof(node, fibre_t, link);
+	while (batch) {
+		f = batch;
+		batch = f->wake_next;
+		atomic_store_explicit(&f->wake_pending, 0, memory_order_release);
+
+		/*
+		 * Clearing the flag must be visible before the fibre runs and
+		 * re-reads its wake up condition. Together with the seq_cst
+		 * exchange in post_atomic() this ensures either the poster
+		 * sees the flag clear (and pushes the fibre again) or the
+		 * fibre sees the new condition.
+		 */
+		atomic_thread_fence(memory_order_seq_cst);
+		wake(f);
 	}
+}
 
+/*
+ * The timer queue is ordered by deadline (duetime + slack) but timers are
+ * released as soon as their duetime has passed. This means that when we
+ * wake for one deadline we also release, in the same batch, any other
+ * timers at the head of the queue whose windows have already opened.
+ */
+static void handle_timerq(void)
+{
+	heap_node_t *node;
+
+	while (NULL != (node = heap_peek(&kernel.timerq))) {
+		fibre_t *timeout_fibre = containerof(node, fibre_t, timer);
+		if (cyclecmp32(timeout_fibre->duetime, kernel.now) > 0)
+			break;
+
+		int32_t lateness = cyclecmp32(kernel.now, timeout_fibre->duetime +
+							  timeout_fibre->slack);
+		if (watchdog_late_budget && lateness > (int32_t) watchdog_late_budget) {
+			add_taint('L');
+			mlog("fibre %p (fn %p) timer fired %uus late", timeout_fibre,
+			     timeout_fibre->fn, (unsigned int) lateness);
+		}
+
+		(void) heap_extract(&kernel.timerq);
+		runq_insert(timeout_fibre);
+		if (get_stats(timeout_fibre))
+			stats_wake(get_stats(timeout_fibre), timeout_fibre->duetime);
+	}
 }
 
 static fibre_t *get_next_task(void)
 {
-	list_node_t *node = list_extract(&kernel.runq);
-	if (!node)
+	if (!kernel.runq_bitmap)
 		return NULL;
 
-	return containerof(node, fibre_t, link);
+	/* the highest priority runnable fibre is found in O(1) time */
+	int priority = 31 - clz(kernel.runq_bitmap);
+	dlist_t *runq = &kernel.runq[priority];
+	fibre_t *f = containerof(dlist_extract(runq), fibre_t, link);
+	if (dlist_empty(runq))
+		kernel.runq_bitmap &= ~(1 << priority);
+
+	f->state = FIBRE_STATE_RUNNING;
+	return f;
+}
+
+/*
+ * Remove a fibre from its wait list. A fibre that was released but has
+ * not yet observed the release gives back anything it was handed.
+ */
+#ifdef CONFIG_FIBRE_SYNC
+static void wait_withdraw(fibre_t *f)
+{
+	dlist_t *list = f->wait_list;
+	fibre_wait_undo_t *undo = f->wait_undo;
+	bool released = f->wait_released;
+
+	f->wait_list = NULL;
+	f->wait_undo = NULL;
+	f->wait_released = false;
+	if (!list)
+		return;
+
+	if (!released)
+		dlist_remove(list, &f->wait_link);
+	else if (undo)
+		undo(list);
+}
+#endif
+
+#ifdef CONFIG_FIBRE_JOIN
+static void cancel_unbind(fibre_t *f)
+{
+	fibre_t **p = &f->cancel->fibres;
+
+	/* the token may have been re-initialized since f was bound */
+	while (*p && *p != f)
+		p = &(*p)->cancel_next;
+	if (*p)
+		*p = f->cancel_next;
+
+	f->cancel = NULL;
+	f->cancel_next = NULL;
+}
+#endif
+
+/*
+ * Called as soon as a fibre exits or is killed so that nothing can run it
+ * again on its behalf (exit notifications are delivered later).
+ */
+static void exit_cleanup(fibre_t *f, int state)
+{
+#ifdef CONFIG_FIBRE_SYNC
+	wait_withdraw(f);
+#endif
+	fd_withdraw(f);
+#ifdef CONFIG_FIBRE_JOIN
+	if (f->cancel)
+		cancel_unbind(f);
+	if (f->cleanup)
+		f->cleanup(f, state);
+#else
+	(void) state;
+#endif
+}
+
+static bool has_exit_notifications(fibre_t *f)
+{
+#ifdef CONFIG_FIBRE_JOIN
+	return f->on_exit || !dlist_empty(&f->joiners);
+#else
+	(void) f;
+	return false;
+#endif
+}
+
+static void notify_exit(fibre_t *f, int state)
+{
+#ifdef CONFIG_FIBRE_JOIN
+	while (fibre_wait_release(&f->joiners))
+		;
+
+	if (f->on_exit)
+		f->on_exit(f, state);
+#else
+	(void) f;
+	(void) state;
+#endif
 }
 
 static void update_current_state(void)
 {
-	kernel.current->state = kernel.state;
+	/*
+	 * If the fibre queued itself whilst it was running (for example by
+	 * calling fibre_timeout()) then the queued state must be preserved
+	 * because it is used to track queue membership.
+	 */
+	if (!(kernel.current->state & FIBRE_STATE_QUEUED))
+		kernel.current->state = kernel.state;
 
 	switch (kernel.state) {
 	case FIBRE_STATE_YIELDED:
@@ -97,8 +456,10 @@ static void update_current_state(void)
 		// fallthru - failed is treated like exited
 	case FIBRE_STATE_EXITED:
 		PT_INIT(&kernel.current->priv);
+		notify_exit(kernel.current, kernel.state);
 		break;
 	case FIBRE_STATE_WAITING:
+	case FIBRE_STATE_KILLED:
 		break;
 	default:
 		assert(0);
@@ -111,22 +472,23 @@ static void update_current_state(void)
 
 static uint32_t get_next_wakeup(void)
 {
-	if (!messageq_empty(&kernel.atomic_runq) || !list_empty(&kernel.runq))
+	if (atomic_load_explicit(&kernel.wakeq, memory_order_relaxed) ||
+	    kernel.runq_bitmap)
 		return kernel.now;
 
-	if (list_empty(&kernel.timerq))
+	if (heap_empty(&kernel.timerq))
 		return kernel.now + FIBRE_UNBOUNDED_SLEEP;
 
-	fibre_t *fibre = containerof(list_peek(&kernel.timerq), fibre_t, link);
-	return fibre->duetime;
+	fibre_t *fibre = containerof(heap_peek(&kernel.timerq), fibre_t, timer);
+	return fibre->duetime + fibre->slack;
 }
 
-static int duetime_cmp(list_node_t *n1, list_node_t *n2)
+static int duetime_cmp(heap_node_t *n1, heap_node_t *n2)
 {
-	fibre_t *f1 = containerof(n1, fibre_t, link);
-	fibre_t *f2 = containerof(n2, fibre_t, link);
+	fibre_t *f1 = containerof(n1, fibre_t, timer);
+	fibre_t *f2 = containerof(n2, fibre_t, timer);
 
-	return f1->duetime - f2->duetime;
+	return cyclecmp32(f1->duetime + f1->slack, f2->duetime + f2->slack);
 }
 
 fibre_t *fibre_self()
@@ -134,9 +496,57 @@ fibre_t *fibre_self()
 	return kernel.current;
 }
 
+void fibre_scheduler_set_wakeup(fibre_wakeup_t *fn, void *ctx)
+{
+	kernel.wakeup = fn;
+	kernel.wakeup_ctx = ctx;
+}
+
+bool fibre_scheduler_sleep_begin(void)
+{
+	assert(kernel.wakeup);
+
+	atomic_store_explicit(&kernel.sleeping, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&kernel.wakeq, memory_order_relaxed)) {
+		atomic_store_explicit(&kernel.sleeping, 0,
+				      memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+void fibre_scheduler_sleep_end(void)
+{
+	atomic_store_explicit(&kernel.sleeping, 0, memory_order_relaxed);
+}
+
+#ifdef CONFIG_FIBRE_SMP
+bool fibre_scheduler_attach(void)
+{
+	unsigned int id = atomic_fetch_add(&num_workers, 1);
+	if (id >= lengthof(workers))
+		return false;
+
+	struct fibre_kernel *k = xzalloc(sizeof(*k));
+	heap_init(&k->timerq, duetime_cmp);
+	k->id = id;
+
+	/*
+	 * No other worker will look up this entry until we set our bit in
+	 * idle_workers so there is no need for any additional barriers.
+	 */
+	workers[id] = k;
+	this_kernel = k;
+	return true;
+}
+#endif
+
 uint32_t fibre_scheduler_next(uint32_t time)
 {
 	kernel.now = time;
+	kernel.passes++;
 
 	/*
 	 * When we have a single fibre yielding to itself we can create a
@@ -144,21 +554,67 @@ uint32_t fibre_scheduler_next(uint32_t time)
 	 * intensive work to be harmed as little as possible even when the
 	 * fibre they run in seeks to cooperate with other fibres.
 	 */
-	if (kernel.state != FIBRE_STATE_YIELDED ||
-	    !list_empty(&kernel.runq) ||
-	    !list_empty(&kernel.timerq) ||
-	    !messageq_empty(&kernel.atomic_runq)) {
+	if (!kernel.current || kernel.state != FIBRE_STATE_YIELDED ||
+	    kernel.runq_bitmap ||
+	    !heap_empty(&kernel.timerq) ||
+	    atomic_load_explicit(&kernel.wakeq, memory_order_relaxed)) {
 		handle_atomic_runq();
 		if (kernel.current)
 			update_current_state();
 		handle_timerq();
 		kernel.current = get_next_task();
+#ifdef CONFIG_FIBRE_SMP
+		if (kernel.runq_bitmap)
+			share_work();
+		update_idle(!kernel.current);
+#endif
+	} else {
+		kernel.fast_path++;
 	}
 
 	if (kernel.current) {
-		kernel.state = kernel.current->fn(kernel.current);
+		fibre_t *f = kernel.current;
+		fibre_stats_t *stats = get_stats(f);
+		bool timed = stats || watchdog_run_budget;
+		uint32_t start = timed ? time_now() : 0;
+
+		if (stats)
+			stats_begin(stats, start);
+#ifdef CONFIG_FIBRE_SYNC
+		f->wait_seen = false;
+#endif
+
+		kernel.state = f->fn(f);
+
+		if (timed) {
+			uint32_t run_time = time_now() - start;
+
+			if (stats)
+				stats_end(stats, run_time);
+			if (watchdog_run_budget && run_time > watchdog_run_budget) {
+				add_taint('W');
+				mlog("fibre %p (fn %p) ran for %uus", f, f->fn,
+				     (unsigned int) run_time);
+			}
+		}
+
+#ifdef CONFIG_FIBRE_SYNC
+		/* a wait the fibre did not query this time has been abandoned */
+		if (f->wait_list && !f->wait_seen)
+			wait_withdraw(f);
+#endif
+
 		if (kernel.state == FIBRE_STATE_YIELDED)
 			return kernel.now;
+
+		if (kernel.state == FIBRE_STATE_EXITED ||
+		    kernel.state == FIBRE_STATE_FAILED) {
+			exit_cleanup(f, kernel.state);
+
+			/* exit notifications are delivered on the next pass */
+			if (has_exit_notifications(f))
+				return kernel.now;
+		}
 	}
 
 	return get_next_wakeup();
@@ -169,53 +625,313 @@ void fibre_init(fibre_t *f, fibre_entrypoint_t *fn)
 	memset(f, 0, sizeof(*f));
 
 	f->fn = fn;
-	// TODO: list_node_init
-	//list_node_init(&f->link);
+}
+
+void fibre_set_priority(fibre_t *f, unsigned int priority)
+{
+	assert(priority < CONFIG_FIBRE_PRIORITIES);
+
+	if (f->state == FIBRE_STATE_RUNNABLE) {
+		runq_remove(f);
+		f->priority = priority;
+		runq_insert(f);
+	} else {
+		f->priority = priority;
+	}
+}
+
+static void wake(fibre_t *f)
+{
+#ifdef CONFIG_FIBRE_SMP
+	struct fibre_kernel *owner = get_owner(f);
+	if (owner != &kernel) {
+		post_atomic(owner, f);
+		return;
+	}
+#endif
+
+	switch (f->state) {
+	case FIBRE_STATE_RUNNABLE:
+		return;
+	case FIBRE_STATE_TIMER_WAITING:
+		(void) heap_remove(&kernel.timerq, &f->timer);
+		break;
+	default:
+		break;
+	}
+
+	runq_insert(f);
+	if (get_stats(f))
+		stats_wake(get_stats(f), time_now());
 }
 
 void fibre_run(fibre_t *f)
 {
 	handle_atomic_runq();
+	wake(f);
+}
+
+bool fibre_run_atomic(fibre_t *f)
+{
+#ifdef CONFIG_FIBRE_SMP
+	post_atomic(get_owner(f), f);
+#else
+	post_atomic(&kernel, f);
+#endif
+	return true;
+}
+
+#ifdef CONFIG_FIBRE_STATS
+void fibre_set_stats(fibre_t *f, fibre_stats_t *stats)
+{
+	if (f->stats)
+		(void) list_remove(&stats_list, &f->stats->link);
+
+	f->stats = stats;
+	if (stats)
+		list_insert(&stats_list, &stats->link);
+}
+#endif
+
+void fibre_get_kernel_stats(fibre_kernel_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef CONFIG_FIBRE_SMP
+	unsigned int nworkers = atomic_load(&num_workers);
+	if (nworkers > lengthof(workers))
+		nworkers = lengthof(workers);
+
+	for (unsigned int i=0; i<nworkers; i++) {
+		if (workers[i]) {
+			stats->passes += workers[i]->passes;
+			stats->fast_path += workers[i]->fast_path;
+		}
+	}
+#else
+	stats->passes = kernel.passes;
+	stats->fast_path = kernel.fast_path;
+#endif
+
+	stats->taint_events = atomic_load(&taint_events);
+	stats->taint_flags = atomic_load(&taint_flags);
+}
 
-	if (!list_contains(&kernel.runq, &f->link, NULL)) {
-		(void) list_remove(&kernel.timerq, &f->link);
-		list_insert(&kernel.runq, &f->link);
+void fibre_watchdog_set(uint32_t run_budget, uint32_t late_budget)
+{
+	watchdog_run_budget = run_budget;
+	watchdog_late_budget = late_budget;
+}
+
+#ifdef CONFIG_FIBRE_STATS
+void fibre_stats_dump(FILE *out)
+{
+	fibre_kernel_stats_t k;
+	list_iterator_t iter;
+	list_node_t *node;
+
+	fibre_get_kernel_stats(&k);
+	fprintf(out, "Scheduler passes %" PRIu32 " (fast path %" PRIu32
+		     "), taint 0x%08" PRIx32 " (%" PRIu32 " events)\n",
+		k.passes, k.fast_path, k.taint_flags, k.taint_events);
+
+	fprintf(out, "%-16s %10s %12s %8s %8s %8s\n", "Fibre", "Runs",
+		"Total(us)", "Max(us)", "AvgLat", "MaxLat");
+	for (node = list_iterate(&stats_list, &iter); node;
+	     node = list_iterator_next(&iter)) {
+		fibre_stats_t *s = containerof(node, fibre_stats_t, link);
+
+		fprintf(out, "%-16s %10" PRIu32 " %12" PRIu64 " %8" PRIu32
+			     " %8" PRIu32 " %8" PRIu32 "\n",
+			s->name ? s->name : "?", s->runs, s->total_run_time,
+			s->max_run_time,
+			s->wakes ? (uint32_t) (s->total_latency / s->wakes) : 0,
+			s->max_latency);
 	}
 }
+#endif
 
-bool fibre_run_atomic(fibre_t *f)
+bool fibre_kill(fibre_t *f)
 {
-	fibre_t **queued_fibre = messageq_claim(&kernel.atomic_runq);
-	if (!queued_fibre) {
-		add_taint('A');
+	handle_atomic_runq();
+
+#ifdef CONFIG_FIBRE_SMP
+	if (atomic_load(&f->owner) != &kernel)
+		return false;
+#endif
+
+	switch (f->state) {
+	case FIBRE_STATE_RUNNABLE:
+		runq_remove(f);
+		break;
+	case FIBRE_STATE_TIMER_WAITING:
+		(void) heap_remove(&kernel.timerq, &f->timer);
+		break;
+	default:
+		/* a fibre that has just yielded will be queued lazily */
+		if (f == kernel.current && kernel.state == FIBRE_STATE_YIELDED) {
+			kernel.state = FIBRE_STATE_KILLED;
+			break;
+		}
+
+#ifdef CONFIG_FIBRE_SYNC
+		/* a fibre blocked on a synchronization object */
+		if (f->wait_list && !f->wait_released)
+			break;
+#endif
+
+#ifdef CONFIG_FIBRE_WAIT_FD
+		/* a fibre waiting for a file descriptor */
+		if (f->wait_fd)
+			break;
+#endif
+
 		return false;
 	}
 
-	*queued_fibre = f;
-	messageq_send(&kernel.atomic_runq, queued_fibre);
+	exit_cleanup(f, FIBRE_STATE_WAITING);
+	f->state = FIBRE_STATE_KILLED;
+	notify_exit(f, FIBRE_STATE_WAITING);
 	return true;
 }
 
-bool fibre_kill(fibre_t *f)
+#ifdef CONFIG_FIBRE_JOIN
+bool fibre_join(fibre_t *f)
 {
-	bool res = false;
+	switch (fibre_wait_state(&f->joiners)) {
+	case FIBRE_WAIT_PENDING:
+		return false;
+	case FIBRE_WAIT_RELEASED:
+		return true;
+	default:
+		break;
+	}
 
-	handle_atomic_runq();
+	if (f->state == FIBRE_STATE_EXITED || f->state == FIBRE_STATE_FAILED ||
+	    f->state == FIBRE_STATE_KILLED)
+		return true;
+
+	fibre_wait_enqueue(&f->joiners);
+	return false;
+}
+
+void fibre_set_exit_handler(fibre_t *f, fibre_exit_fn_t *fn)
+{
+	f->on_exit = fn;
+}
+
+void fibre_set_cleanup_handler(fibre_t *f, fibre_exit_fn_t *fn)
+{
+	f->cleanup = fn;
+}
+
+void fibre_cancel_init(fibre_cancel_t *c)
+{
+	memset(c, 0, sizeof(*c));
+}
+
+void fibre_cancel_bind(fibre_cancel_t *c, fibre_t *f)
+{
+	assert(!f->cancel);
+
+	f->cancel = c;
+	f->cancel_next = c->fibres;
+	c->fibres = f;
+}
+
+void fibre_cancel(fibre_cancel_t *c)
+{
+	c->cancelled = true;
+
+	for (fibre_t *f = c->fibres; f; f = f->cancel_next) {
+		wait_withdraw(f);
+		fibre_run(f);
+	}
+}
+
+bool fibre_cancelled(void)
+{
+	fibre_t *f = kernel.current;
+
+	return f->cancel && f->cancel->cancelled;
+}
+#endif
+
+#ifdef CONFIG_FIBRE_SYNC
+fibre_wait_state_t fibre_wait_state(dlist_t *waiters)
+{
+	fibre_t *f = kernel.current;
+
+	if (f->wait_list != waiters)
+		return FIBRE_WAIT_NONE;
+
+	f->wait_seen = true;
+	if (!f->wait_released)
+		return FIBRE_WAIT_PENDING;
+
+	f->wait_list = NULL;
+	f->wait_undo = NULL;
+	f->wait_released = false;
+	return FIBRE_WAIT_RELEASED;
+}
+
+void fibre_wait_enqueue(dlist_t *waiters)
+{
+	fibre_t *f = kernel.current;
+
+	if (f->wait_list)
+		wait_withdraw(f);
+	f->wait_list = waiters;
+	f->wait_seen = true;
+	dlist_insert(waiters, &f->wait_link);
+}
 
-	res |= list_remove(&kernel.runq, &f->link);
-	res |= list_remove(&kernel.timerq, &f->link);
+fibre_t *fibre_wait_release(dlist_t *waiters)
+{
+	return fibre_wait_handover(waiters, NULL);
+}
+
+fibre_t *fibre_wait_handover(dlist_t *waiters, fibre_wait_undo_t *undo)
+{
+	dlist_node_t *node = dlist_extract(waiters);
+	if (!node)
+		return NULL;
 
-	return res;
+	fibre_t *f = containerof(node, fibre_t, wait_link);
+	f->wait_list = waiters;
+	f->wait_released = true;
+	f->wait_undo = undo;
+	fibre_run(f);
+	return f;
 }
+#endif
 
 bool fibre_timeout(uint32_t duetime)
+{
+	return fibre_timeout_slack(duetime, 0);
+}
+
+bool fibre_timeout_slack(uint32_t duetime, uint32_t slack)
 {
 	if (cyclecmp32(duetime, kernel.now) <= 0)
 		return true;
 
-	kernel.current->duetime = duetime;
-	if (!list_contains(&kernel.runq, &kernel.current->link, NULL))
-		list_insert_sorted(&kernel.timerq, &kernel.current->link, duetime_cmp);
+	fibre_t *f = kernel.current;
+	switch (f->state) {
+	case FIBRE_STATE_RUNNABLE:
+		return false;
+	case FIBRE_STATE_TIMER_WAITING:
+		/* re-arming a timer requires it to be repositioned */
+		(void) heap_remove(&kernel.timerq, &f->timer);
+		break;
+	default:
+		break;
+	}
+
+	f->duetime = duetime;
+	f->slack = slack;
+	heap_insert(&kernel.timerq, &f->timer);
+	f->state = FIBRE_STATE_TIMER_WAITING;
 	return false;
 }
 
@@ -254,3 +970,28 @@ void fibre_eventq_release(fibre_eventq_t *evtq, void *evtp)
 {
 	messageq_release(&evtq->eventq, evtp);
 }
+
+void *fibre_eventq_claim_span(fibre_eventq_t *evtq, unsigned int *n)
+{
+	void *evtp = messageq_claim_span(&evtq->eventq, n);
+	if (!evtp)
+		add_taint('E');
+	return evtp;
+}
+
+bool fibre_eventq_send_span(fibre_eventq_t *evtq, void *evtp, unsigned int n)
+{
+	messageq_send_span(&evtq->eventq, evtp, n);
+	return fibre_run_atomic(&evtq->fibre);
+}
+
+void *fibre_eventq_receive_span(fibre_eventq_t *evtq, unsigned int *n)
+{
+	return messageq_receive_span(&evtq->eventq, n);
+}
+
+void fibre_eventq_release_span(fibre_eventq_t *evtq, void *evtp,
+			       unsigned int n)
+{
+	messageq_release_span(&evtq->eventq, evtp, n);
+}
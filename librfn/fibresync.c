@@ -0,0 +1,197 @@
+/*
+ * fibresync.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/fibresync.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "librfn/util.h"
+
+#ifndef CONFIG_FIBRE_SYNC
+#error fibre synchronization objects require CONFIG_FIBRE_SYNC
+#endif
+
+void fibre_mutex_init(fibre_mutex_t *m)
+{
+	memset(m, 0, sizeof(*m));
+}
+
+bool fibre_mutex_lock(fibre_mutex_t *m)
+{
+	fibre_t *f = fibre_self();
+
+	switch (fibre_wait_state(&m->waiters)) {
+	case FIBRE_WAIT_PENDING:
+		return false;
+	case FIBRE_WAIT_RELEASED:
+		/* ownership was handed over by fibre_mutex_unlock() */
+		assert(m->owner == f);
+		return true;
+	default:
+		break;
+	}
+
+	if (!m->owner) {
+		m->owner = f;
+		return true;
+	}
+
+	assert(m->owner != f);
+	fibre_wait_enqueue(&m->waiters);
+	return false;
+}
+
+/* pass ownership on if the fibre we handed it to never takes it */
+static void mutex_handback(dlist_t *waiters)
+{
+	fibre_mutex_t *m = containerof(waiters, fibre_mutex_t, waiters);
+
+	m->owner = fibre_wait_handover(&m->waiters, mutex_handback);
+}
+
+void fibre_mutex_unlock(fibre_mutex_t *m)
+{
+	assert(m->owner == fibre_self());
+
+	fibre_t *f = fibre_wait_handover(&m->waiters, mutex_handback);
+	m->owner = f;
+}
+
+void fibre_sem_init(fibre_sem_t *s, unsigned int count)
+{
+	memset(s, 0, sizeof(*s));
+	s->count = count;
+}
+
+static void sem_handback(dlist_t *waiters)
+{
+	fibre_sem_post(containerof(waiters, fibre_sem_t, waiters));
+}
+
+bool fibre_sem_wait(fibre_sem_t *s)
+{
+	switch (fibre_wait_state(&s->waiters)) {
+	case FIBRE_WAIT_PENDING:
+		return false;
+	case FIBRE_WAIT_RELEASED:
+		/* fibre_sem_post() gave us its unit directly */
+		return true;
+	default:
+		break;
+	}
+
+	if (s->count) {
+		s->count--;
+		return true;
+	}
+
+	fibre_wait_enqueue(&s->waiters);
+	return false;
+}
+
+void fibre_sem_post(fibre_sem_t *s)
+{
+	if (!fibre_wait_handover(&s->waiters, sem_handback))
+		s->count++;
+}
+
+void fibre_cond_init(fibre_cond_t *c)
+{
+	memset(c, 0, sizeof(*c));
+}
+
+bool fibre_cond_wait(fibre_cond_t *c, fibre_mutex_t *m)
+{
+	/* once signalled we may have to wait to reacquire the mutex */
+	switch (fibre_wait_state(&m->waiters)) {
+	case FIBRE_WAIT_PENDING:
+		return false;
+	case FIBRE_WAIT_RELEASED:
+		assert(m->owner == fibre_self());
+		return true;
+	default:
+		break;
+	}
+
+	switch (fibre_wait_state(&c->waiters)) {
+	case FIBRE_WAIT_PENDING:
+		return false;
+	case FIBRE_WAIT_RELEASED:
+		return fibre_mutex_lock(m);
+	default:
+		break;
+	}
+
+	fibre_mutex_unlock(m);
+	fibre_wait_enqueue(&c->waiters);
+	return false;
+}
+
+/* a signal that was not consumed wakes the next waiter instead */
+static void cond_handback(dlist_t *waiters)
+{
+	(void) fibre_wait_handover(waiters, cond_handback);
+}
+
+void fibre_cond_signal(fibre_cond_t *c)
+{
+	(void) fibre_wait_handover(&c->waiters, cond_handback);
+}
+
+void fibre_cond_broadcast(fibre_cond_t *c)
+{
+	while (fibre_wait_release(&c->waiters))
+		;
+}
+
+void fibre_event_init(fibre_event_t *e)
+{
+	memset(e, 0, sizeof(*e));
+}
+
+static bool event_wait(fibre_event_t *e, bool ready)
+{
+	if (FIBRE_WAIT_PENDING == fibre_wait_state(&e->waiters))
+		return false;
+
+	if (ready)
+		return true;
+
+	fibre_wait_enqueue(&e->waiters);
+	return false;
+}
+
+bool fibre_event_wait_any(fibre_event_t *e, uint32_t mask)
+{
+	return event_wait(e, e->flags & mask);
+}
+
+bool fibre_event_wait_all(fibre_event_t *e, uint32_t mask)
+{
+	return event_wait(e, (e->flags & mask) == mask);
+}
+
+void fibre_event_set(fibre_event_t *e, uint32_t mask)
+{
+	e->flags |= mask;
+
+	/* waiters re-evaluate their condition (and re-queue if needed) */
+	while (fibre_wait_release(&e->waiters))
+		;
+}
+
+void fibre_event_clear(fibre_event_t *e, uint32_t mask)
+{
+	e->flags &= ~mask;
+}
@@ -0,0 +1,148 @@
+/*
+ * heap.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/heap.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "librfn/util.h"
+
+static int compare(heap_t *heap, heap_node_t *a, heap_node_t *b)
+{
+	int res = heap->nodecmp(a, b);
+
+	/* break ties using the insertion order to keep the heap stable */
+	return res ? res : cyclecmp32(a->seq, b->seq);
+}
+
+/* Both a and b must be roots (i.e. have no siblings and no parent) */
+static heap_node_t *meld(heap_t *heap, heap_node_t *a, heap_node_t *b)
+{
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+
+	if (compare(heap, b, a) < 0) {
+		heap_node_t *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* b becomes the first child of a */
+	b->prev = a;
+	b->sibling = a->child;
+	if (a->child)
+		a->child->prev = b;
+	a->child = b;
+
+	return a;
+}
+
+/*
+ * Classic two-pass pairing. The first pass melds the siblings together in
+ * pairs from left-to-right and the second pass melds the resulting trees
+ * from right-to-left. The first pass threads the intermediate trees into
+ * a stack through their (otherwise unused) sibling pointers so no memory
+ * allocation or recursion is required.
+ */
+static heap_node_t *merge_pairs(heap_t *heap, heap_node_t *first)
+{
+	heap_node_t *stack = NULL, *root = NULL;
+
+	while (first) {
+		heap_node_t *a = first;
+		heap_node_t *b = a->sibling;
+
+		first = b ? b->sibling : NULL;
+
+		a->prev = a->sibling = NULL;
+		if (b)
+			b->prev = b->sibling = NULL;
+
+		a = meld(heap, a, b);
+		a->sibling = stack;
+		stack = a;
+	}
+
+	while (stack) {
+		heap_node_t *next = stack->sibling;
+
+		stack->sibling = NULL;
+		root = meld(heap, stack, root);
+		stack = next;
+	}
+
+	return root;
+}
+
+void heap_init(heap_t *heap, heap_node_compare_t *nodecmp)
+{
+	memset(heap, 0, sizeof(*heap));
+
+	heap->nodecmp = nodecmp;
+}
+
+void heap_insert(heap_t *heap, heap_node_t *node)
+{
+	assert(!heap_contains(heap, node));
+
+	node->child = NULL;
+	node->sibling = NULL;
+	node->seq = heap->seq++;
+
+	heap->root = meld(heap, heap->root, node);
+}
+
+heap_node_t *heap_extract(heap_t *heap)
+{
+	heap_node_t *node = heap->root;
+
+	if (!node)
+		return NULL;
+
+	heap->root = merge_pairs(heap, node->child);
+	node->child = NULL;
+
+	return node;
+}
+
+bool heap_remove(heap_t *heap, heap_node_t *node)
+{
+	if (node == heap->root) {
+		(void) heap_extract(heap);
+		return true;
+	}
+
+	if (!node->prev)
+		return false;
+
+	/* unlink the node (and its sub-heap) from its parent or sibling */
+	if (node->prev->child == node)
+		node->prev->child = node->sibling;
+	else
+		node->prev->sibling = node->sibling;
+	if (node->sibling)
+		node->sibling->prev = node->prev;
+	node->prev = NULL;
+	node->sibling = NULL;
+
+	/* reattach the children of the node to the root */
+	heap->root = meld(heap, heap->root, merge_pairs(heap, node->child));
+	node->child = NULL;
+
+	return true;
+}
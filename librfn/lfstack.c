@@ -0,0 +1,103 @@
+/*
+ * lfstack.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/lfstack.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/*
+ * The nodes are ordinary list_node_t structures so the GNU C atomic
+ * builtins are used directly rather than requiring _Atomic members.
+ *
+ * When LFSTACK_ABA_SAFE is set the top pointer and tag are updated
+ * together using the legacy __sync builtin (the __atomic builtins may
+ * defer double word operations to libatomic which is not guaranteed to
+ * be lock-free). Every successful pop increments the tag so a pop that
+ * raced with a pop/push of the same node will fail its compare-and-swap.
+ * The two halves are loaded separately; a torn read is harmless because
+ * the compare-and-swap then fails and the operation is retried.
+ */
+
+static inline void load(lfstack_t *s, lfstack_t *old)
+{
+	old->head.tag = __atomic_load_n(&s->head.tag, __ATOMIC_RELAXED);
+	old->head.top = __atomic_load_n(&s->head.top, __ATOMIC_ACQUIRE);
+}
+
+static inline bool update(lfstack_t *s, lfstack_t *old, list_node_t *top,
+			  bool retag)
+{
+#if LFSTACK_ABA_SAFE
+	lfstack_t new;
+
+	new.head.top = top;
+	new.head.tag = old->head.tag + retag;
+	return __sync_bool_compare_and_swap(&s->raw, old->raw, new.raw);
+#else
+	(void) retag;
+	return __atomic_compare_exchange_n(&s->head.top, &old->head.top, top,
+					   true, __ATOMIC_ACQ_REL,
+					   __ATOMIC_ACQUIRE);
+#endif
+}
+
+void lfstack_push(lfstack_t *s, list_node_t *node)
+{
+	lfstack_t old;
+
+	assert(NULL == node->next);
+
+	do {
+		load(s, &old);
+		__atomic_store_n(&node->next, old.head.top, __ATOMIC_RELAXED);
+	} while (!update(s, &old, node, false));
+}
+
+list_node_t *lfstack_pop(lfstack_t *s)
+{
+	lfstack_t old;
+	list_node_t *next;
+
+	do {
+		load(s, &old);
+		if (!old.head.top)
+			return NULL;
+		next = __atomic_load_n(&old.head.top->next, __ATOMIC_RELAXED);
+	} while (!update(s, &old, next, true));
+
+	old.head.top->next = NULL;
+	return old.head.top;
+}
+
+list_node_t *lfstack_pop_all(lfstack_t *s)
+{
+#if LFSTACK_ABA_SAFE
+	lfstack_t old;
+
+	do {
+		load(s, &old);
+		if (!old.head.top)
+			return NULL;
+	} while (!update(s, &old, NULL, true));
+
+	return old.head.top;
+#else
+	return __atomic_exchange_n(&s->head.top, NULL, __ATOMIC_ACQ_REL);
+#endif
+}
+
+bool lfstack_empty(lfstack_t *s)
+{
+	return !__atomic_load_n(&s->head.top, __ATOMIC_RELAXED);
+}
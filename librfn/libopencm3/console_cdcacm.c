@@ -196,11 +196,9 @@ static void cdcacm_set_config(usbd_device *usbd_dev, uint16_t wValue);
 
 struct output_task {
 	fibre_t fibre;
-	uint8_t ch;
 };
 static int output_fibre(fibre_t *fibre)
 {
-	struct output_task *t = containerof(fibre, struct output_task, fibre);
 	PT_BEGIN_FIBRE(fibre);
 
 	/* Initial timeout to allow things to settle. This proved necessary
@@ -213,15 +211,18 @@ static int output_fibre(fibre_t *fibre)
 		PT_WAIT_UNTIL(fibre_timeout(2000000));
 
 	while (true) {
-		int ch = ringbuf_get(&outring);
-		if (-1 == ch)
+		size_t n;
+		uint8_t *p = ringbuf_peek_contig(&outring, &n);
+		if (!n)
 			PT_EXIT();
 
-		t->ch = ch;
-
-		while (!usbd_ep_write_packet(usbd_dev, 0x82, &t->ch, 1))
+		/* send directly from the ring buffer, one packet at a time */
+		if (n > 64)
+			n = 64;
+		if (usbd_ep_write_packet(usbd_dev, 0x82, p, n))
+			ringbuf_consume(&outring, n);
+		else
 			PT_YIELD();
-
 	}
 
 	PT_END();
@@ -362,11 +363,16 @@ static void cdcacm_set_config(usbd_device *dev, uint16_t wValue)
 int _write(int fd, char *ptr, int len)
 {
 	if (fd == 1 || fd == 2) {
+		int start = 0;
 		for (int i=0; i<len; i++) {
-			if (ptr[i] == '\n')
+			if (ptr[i] == '\n') {
+				(void) ringbuf_write(&outring, ptr + start,
+						     i - start);
 				(void) ringbuf_put(&outring, '\r');
-			(void) ringbuf_put(&outring, ptr[i]);
+				start = i;
+			}
 		}
+		(void) ringbuf_write(&outring, ptr + start, len - start);
 		fibre_run(&output_task.fibre);
 		return 0;
 	}
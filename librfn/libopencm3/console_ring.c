@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 
 #include <libopencm3/stm32/rcc.h>
@@ -39,25 +40,38 @@ void console_hwinit(console_t *c)
 	logcon = c;
 }
 
-static void logchar(char ch)
+static void discard_line(void)
 {
-	if (ringbuf_put(&logring, ch))
-		return;
+	uint8_t *p;
+	size_t n;
 
-	/* ring buffer is full, discard characters until end-of-line */
-	int discard;
-	do {
-		discard = ringbuf_get(&logring);
-	} while (discard != -1 && discard != '\n');
+	while ((p = ringbuf_peek_contig(&logring, &n)), n) {
+		uint8_t *nl = memchr(p, '\n', n);
+		if (nl) {
+			ringbuf_consume(&logring, nl - p + 1);
+			return;
+		}
+		ringbuf_consume(&logring, n);
+	}
+}
 
-	ringbuf_put(&logring, ch);
+static void logwrite(const char *ptr, size_t len)
+{
+	while (len) {
+		size_t n = ringbuf_write(&logring, ptr, len);
+		ptr += n;
+		len -= n;
+
+		/* ring buffer is full, discard characters until end-of-line */
+		if (len)
+			discard_line();
+	}
 }
 
 int _write(int file, char *ptr, int len)
 {
 	if (file == 1 || file == 2) {
-		for (int i=0; i<len; i++)
-			logchar(ptr[i]);
+		logwrite(ptr, len);
 		return 0;
 	}
 
@@ -152,6 +152,117 @@ list_node_t * list_iterator_remove(list_iterator_t *iter)
 	return *(iter->prevnext);
 }
 
+void list_splice(list_t *list, list_t *src)
+{
+	if (!src->head)
+		return;
+
+	if (list->head)
+		list->tail->next = src->head;
+	else
+		list->head = src->head;
+	list->tail = src->tail;
+
+	src->head = NULL;
+}
+
+void list_split(list_t *list, list_node_t *node, list_t *rest)
+{
+	assert(!rest->head);
+
+	if (!node) {
+		*rest = *list;
+		list->head = NULL;
+		return;
+	}
+
+	if (node->next) {
+		rest->head = node->next;
+		rest->tail = list->tail;
+		node->next = NULL;
+		list->tail = node;
+	}
+}
+
+/*
+ * Merge two NULL terminated chains. Nodes from a come first when nodes
+ * compare equal, making the merge stable providing a holds the earlier
+ * nodes.
+ */
+static list_node_t *merge(list_node_t *a, list_node_t *b,
+			  list_node_compare_t *nodecmp)
+{
+	list_node_t *head = NULL;
+	list_node_t **prevnext = &head;
+
+	while (a && b) {
+		if (nodecmp(b, a) < 0) {
+			*prevnext = b;
+			b = b->next;
+		} else {
+			*prevnext = a;
+			a = a->next;
+		}
+		prevnext = &(*prevnext)->next;
+	}
+	*prevnext = a ? a : b;
+
+	return head;
+}
+
+void list_merge_sorted(list_t *list, list_t *src, list_node_compare_t *nodecmp)
+{
+	if (!src->head)
+		return;
+
+	if (!list->head) {
+		*list = *src;
+		src->head = NULL;
+		return;
+	}
+
+	if (nodecmp(src->tail, list->tail) >= 0)
+		list->tail = src->tail;
+	list->head = merge(list->head, src->head, nodecmp);
+	src->head = NULL;
+}
+
+void list_sort(list_t *list, list_node_compare_t *nodecmp)
+{
+	/* bins[i] is either empty or holds a sorted run of 2^i nodes */
+	list_node_t *bins[32] = { NULL };
+	list_node_t *node = list->head;
+	int max = 0;
+
+	while (node) {
+		list_node_t *carry = node;
+		node = node->next;
+		carry->next = NULL;
+
+		/* bins hold older nodes than carry so they go first */
+		int i;
+		for (i = 0; bins[i]; i++) {
+			carry = merge(bins[i], carry, nodecmp);
+			bins[i] = NULL;
+		}
+		bins[i] = carry;
+		if (i >= max)
+			max = i + 1;
+	}
+
+	/* lower bins hold the newest nodes */
+	node = NULL;
+	for (int i = 0; i < max; i++)
+		if (bins[i])
+			node = merge(bins[i], node, nodecmp);
+
+	list->head = node;
+	while (node) {
+		list->tail = node;
+		node = node->next;
+	}
+}
+
 bool list_contains(list_t *list, list_node_t *node, list_iterator_t *iter)
 {
 	list_iterator_t myiter;
@@ -18,6 +18,23 @@
 
 #include "librfn/util.h"
 
+/*
+ * Senders and releasers must wake any thread blocked in
+ * messageq_claim_wait() or messageq_receive_wait(). The waiter count
+ * ensures this costs only a load when no thread is blocked. Both the
+ * waiter and the waker use sequentially consistent operations so either
+ * the waiter observes the queue update or the waker observes the waiter.
+ */
+static inline void wake_waiters(messageq_t *mq)
+{
+#ifdef CONFIG_MESSAGEQ_WAIT
+	if (atomic_load(&mq->waiters))
+		messageq_wake(mq);
+#else
+	(void) mq;
+#endif
+}
+
 void messageq_init(messageq_t *mq, void *basep, size_t base_len, size_t msg_len)
 {
 	memset(mq, 0, sizeof(*mq));
@@ -52,6 +69,7 @@ void messageq_send(messageq_t *mq, void *msg)
 	unsigned int offset = (((char *) msg) - mq->basep);
 	unsigned int sendp = offset / mq->msg_len;
 	atomic_fetch_or(&mq->full_flags, (1 << sendp));
+	wake_waiters(mq);
 }
 
 void *messageq_receive(messageq_t *mq)
@@ -78,4 +96,85 @@ void messageq_release(messageq_t *mq, void *msg)
 	 */
 	(void)msg;
 	atomic_fetch_add(&mq->num_free, 1);
+	wake_waiters(mq);
+}
+
+static unsigned int span_mask(unsigned int first, unsigned int n)
+{
+	unsigned int mask = n >= 32 ? ~0u : (1u << n) - 1;
+	return mask << first;
+}
+
+void *messageq_claim_span(messageq_t *mq, unsigned int *n)
+{
+	/* get permission to allocate up to *n messages */
+	unsigned char num_free = atomic_load(&mq->num_free);
+	unsigned char reserved;
+	do {
+		/* num_free can transiently underflow (see messageq_claim) */
+		if (num_free == 0 || num_free > mq->queue_len) {
+			*n = 0;
+			return NULL;
+		}
+		reserved = *n < num_free ? *n : num_free;
+	} while (!atomic_compare_exchange_weak(&mq->num_free, &num_free,
+					       num_free - reserved));
+
+	/* allocate a contiguous span (which cannot wrap around the end) */
+	unsigned char sendp = atomic_load(&mq->sendp);
+	unsigned char newsendp, span;
+	do {
+		span = mq->queue_len - sendp;
+		span = reserved < span ? reserved : span;
+		newsendp = (sendp + span >= mq->queue_len ? 0 : sendp + span);
+	} while(!atomic_compare_exchange_weak(&mq->sendp, &sendp, newsendp));
+
+	/* return anything we reserved but could not use */
+	if (span != reserved)
+		atomic_fetch_add(&mq->num_free, reserved - span);
+
+	*n = span;
+	return mq->basep + (sendp * mq->msg_len);
+}
+
+void messageq_send_span(messageq_t *mq, void *msg, unsigned int n)
+{
+	unsigned int offset = (((char *) msg) - mq->basep);
+	unsigned int sendp = offset / mq->msg_len;
+	atomic_fetch_or(&mq->full_flags, span_mask(sendp, n));
+	wake_waiters(mq);
+}
+
+void *messageq_receive_span(messageq_t *mq, unsigned int *n)
+{
+	unsigned int receivep = mq->receivep;
+	unsigned int full_flags = atomic_load(&mq->full_flags);
+	unsigned int limit = mq->queue_len - receivep;
+	unsigned int span = 0;
+
+	if (*n < limit)
+		limit = *n;
+	while (span < limit && (full_flags & (1 << (receivep + span))))
+		span++;
+
+	*n = span;
+	if (!span)
+		return NULL;
+
+	/*
+	 * Senders only ever set bits in full_flags so the bits we observed
+	 * cannot have changed since we looked at them.
+	 */
+	atomic_fetch_and(&mq->full_flags, ~span_mask(receivep, span));
+
+	mq->receivep = (receivep + span >= mq->queue_len ? 0 : receivep + span);
+
+	return mq->basep + (receivep * mq->msg_len);
+}
+
+void messageq_release_span(messageq_t *mq, void *msg, unsigned int n)
+{
+	(void)msg;
+	atomic_fetch_add(&mq->num_free, n);
+	wake_waiters(mq);
 }
@@ -0,0 +1,126 @@
+/*
+ * mpmcq.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/mpmcq.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Slot i is free for the sender at position pos when its sequence number
+ * equals pos and full for the receiver at position pos when its sequence
+ * number equals pos + 1. Releasing a message advances the sequence number
+ * to the position the slot will next be sent from.
+ *
+ * The sequence numbers are stored relative to the slot index (so each
+ * slot initially reads as zero) which allows the caller to provide zero
+ * initialized storage rather than having to number every slot.
+ */
+
+static inline unsigned int load_seq(mpmcq_t *q, unsigned int idx)
+{
+	return atomic_load_explicit(&q->seqp[idx], memory_order_acquire) + idx;
+}
+
+static inline void store_seq(mpmcq_t *q, unsigned int idx, unsigned int seq)
+{
+	atomic_store_explicit(&q->seqp[idx], seq - idx, memory_order_release);
+}
+
+static inline unsigned int msg_index(mpmcq_t *q, void *msg)
+{
+	unsigned int idx = (((char *) msg) - q->basep) / q->msg_len;
+	assert(idx <= q->mask);
+	return idx;
+}
+
+void mpmcq_init(mpmcq_t *q, void *basep, atomic_uint *seqp, size_t base_len,
+		size_t msg_len)
+{
+	unsigned int queue_len = base_len / msg_len;
+
+	/* queue length must be a power of two */
+	assert(queue_len && 0 == (queue_len & (queue_len - 1)));
+
+	memset(q, 0, sizeof(*q));
+	memset(seqp, 0, queue_len * sizeof(*seqp));
+
+	q->basep = basep;
+	q->seqp = seqp;
+	q->msg_len = msg_len;
+	q->mask = queue_len - 1;
+}
+
+void *mpmcq_claim(mpmcq_t *q)
+{
+	unsigned int pos = atomic_load_explicit(&q->sendp, memory_order_relaxed);
+
+	while (true) {
+		unsigned int idx = pos & q->mask;
+		int diff = (int) (load_seq(q, idx) - pos);
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(
+				    &q->sendp, &pos, pos + 1,
+				    memory_order_relaxed, memory_order_relaxed))
+				return q->basep + (idx * q->msg_len);
+		} else if (diff < 0) {
+			/* slot still holds a message from the previous lap */
+			return NULL;
+		} else {
+			/* another sender beat us to it */
+			pos = atomic_load_explicit(&q->sendp,
+						   memory_order_relaxed);
+		}
+	}
+}
+
+void mpmcq_send(mpmcq_t *q, void *msg)
+{
+	unsigned int idx = msg_index(q, msg);
+
+	/* no-one else can update the sequence number of a claimed slot */
+	store_seq(q, idx, load_seq(q, idx) + 1);
+}
+
+void *mpmcq_receive(mpmcq_t *q)
+{
+	unsigned int pos =
+	    atomic_load_explicit(&q->receivep, memory_order_relaxed);
+
+	while (true) {
+		unsigned int idx = pos & q->mask;
+		int diff = (int) (load_seq(q, idx) - (pos + 1));
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(
+				    &q->receivep, &pos, pos + 1,
+				    memory_order_relaxed, memory_order_relaxed))
+				return q->basep + (idx * q->msg_len);
+		} else if (diff < 0) {
+			/* slot is empty (or claimed but not yet sent) */
+			return NULL;
+		} else {
+			pos = atomic_load_explicit(&q->receivep,
+						   memory_order_relaxed);
+		}
+	}
+}
+
+void mpmcq_release(mpmcq_t *q, void *msg)
+{
+	unsigned int idx = msg_index(q, msg);
+
+	/* hand the slot to the sender one lap further round the ring */
+	store_seq(q, idx, load_seq(q, idx) + q->mask);
+}
@@ -0,0 +1,83 @@
+/*
+ * mpscq.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/mpscq.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/*
+ * This is Dmitry Vyukov's intrusive MPSC queue. The queue always contains
+ * at least one node, which is the stub node when nothing else is queued,
+ * so producers never need to update the consumer's head pointer. A NULL
+ * head or tail pointer refers to the stub node which allows a zero
+ * initialized queue to be valid.
+ *
+ * As with lfstack_t the nodes are ordinary list_node_t structures so the
+ * GNU C atomic builtins are used directly.
+ */
+
+static inline list_node_t *stub_if_null(mpscq_t *q, list_node_t *node)
+{
+	return node ? node : &q->stub;
+}
+
+void mpscq_insert(mpscq_t *q, list_node_t *node)
+{
+	assert(NULL == node->next);
+
+	list_node_t *prev = __atomic_exchange_n(&q->tail, node, __ATOMIC_ACQ_REL);
+	__atomic_store_n(&stub_if_null(q, prev)->next, node, __ATOMIC_RELEASE);
+}
+
+list_node_t *mpscq_extract(mpscq_t *q)
+{
+	list_node_t *head = stub_if_null(q, q->head);
+	list_node_t *next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+
+	/* skip over the stub */
+	if (head == &q->stub) {
+		if (!next)
+			return NULL;
+		q->head = head = next;
+		next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+	}
+
+	/* head is the last node and can only be removed once the stub has
+	 * been queued behind it
+	 */
+	if (!next) {
+		list_node_t *tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+		if (head != stub_if_null(q, tail))
+			return NULL; /* an insertion is in progress */
+
+		q->stub.next = NULL;
+		mpscq_insert(q, &q->stub);
+
+		next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+		if (!next)
+			return NULL;
+	}
+
+	q->head = next;
+	head->next = NULL;
+	return head;
+}
+
+bool mpscq_empty(mpscq_t *q)
+{
+	list_node_t *head = stub_if_null(q, q->head);
+
+	return head == &q->stub &&
+	       !__atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+}
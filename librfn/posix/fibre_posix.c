@@ -11,10 +11,27 @@
  * (at your option) any later version.
  */
 
+/* ppoll() and pipe2() are GNU extensions (we fall back if they are absent) */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#ifdef CONFIG_FIBRE_SMP
+#include <pthread.h>
+#endif
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef CONFIG_FIBRE_WAIT_FD
+#include <sys/epoll.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
 #include <time.h>
 #include <unistd.h>
 
@@ -22,13 +39,287 @@
 #include "librfn/time.h"
 #include "librfn/util.h"
 
+/*
+ * The scheduler sleeps in ppoll() until the next timer is due or until
+ * the wakeup fd is signalled by fibre_run_atomic(). Writing to an eventfd
+ * (or pipe) is async-signal-safe so fibres can be woken by signal handlers
+ * as well as other threads.
+ */
+struct wakeup_fds {
+	int rd;
+	int wr;
+};
+
+static void wakeup(void *ctx)
+{
+	struct wakeup_fds *fds = ctx;
+	uint64_t one = 1;
+
+	/* if this fails the fd is already readable so there's nothing to do */
+	(void) !write(fds->wr, &one, sizeof(one));
+}
+
+static void drain(struct wakeup_fds *fds)
+{
+	uint64_t buf[8];
+
+	while (read(fds->rd, buf, sizeof(buf)) > 0)
+		;
+}
+
+static void open_wakeup_fds(struct wakeup_fds *fds)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+	fds->rd = fds->wr = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	assert(fds->rd >= 0);
+#else
+	int pipefd[2];
+#ifdef HAVE_PIPE2
+	int res = pipe2(pipefd, O_CLOEXEC | O_NONBLOCK);
+	assert(0 == res);
+#else
+	int res = pipe(pipefd);
+	assert(0 == res);
+	for (int i=0; i<2; i++) {
+		res = fcntl(pipefd[i], F_SETFD, FD_CLOEXEC) |
+		      fcntl(pipefd[i], F_SETFL, O_NONBLOCK);
+		assert(0 == res);
+	}
+#endif
+	(void) res;
+	fds->rd = pipefd[0];
+	fds->wr = pipefd[1];
+#endif
+}
+
+#ifdef CONFIG_FIBRE_WAIT_FD
+/*
+ * Each thread running a scheduler has its own epoll set. Events are keyed
+ * by descriptor and the fibre waiting for each descriptor is looked up in
+ * fd_waiters (rather than being stored in the event itself) so that a
+ * stale event can never reach a fibre that is no longer waiting.
+ *
+ * The descriptors registered by a fibre are chained together through
+ * fd_waiters, starting from fibre_t::wait_fd, so they can be dropped
+ * without searching the table. Descriptors are stored plus one so that
+ * zero can terminate the chain.
+ *
+ * A registration lasts only until the waiting fibre next becomes runnable,
+ * exits or is killed; fibres that are still waiting will register again
+ * when they re-evaluate their wait condition.
+ */
+struct fd_waiter {
+	fibre_t *fibre;
+	int next;
+};
+
+static __thread int epoll_fd = -1;
+static __thread struct fd_waiter *fd_waiters;
+static __thread int fd_waiters_len;
+
+static int get_epoll_fd(void)
+{
+	if (epoll_fd < 0) {
+		epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		assert(epoll_fd >= 0);
+	}
+
+	return epoll_fd;
+}
+
+static void grow_fd_waiters(int fd)
+{
+	int len = fd_waiters_len ? fd_waiters_len : 16;
+	while (len <= fd)
+		len *= 2;
+
+	struct fd_waiter *p = realloc(fd_waiters, len * sizeof(*p));
+	if (!p)
+		rf_internal_out_of_memory();
+	memset(p + fd_waiters_len, 0, (len - fd_waiters_len) * sizeof(*p));
+
+	fd_waiters = p;
+	fd_waiters_len = len;
+}
+
+static void unlink_fd(int fd)
+{
+	int *p = &fd_waiters[fd].fibre->wait_fd;
+
+	while (*p != fd + 1)
+		p = &fd_waiters[*p - 1].next;
+	*p = fd_waiters[fd].next;
+	fd_waiters[fd].fibre = NULL;
+}
+
+static void drop_fd(int fd)
+{
+	unlink_fd(fd);
+
+	/* fails harmlessly if the descriptor has already been closed */
+	(void) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+void fibre_wait_fd_withdraw(fibre_t *f)
+{
+	while (f->wait_fd)
+		drop_fd(f->wait_fd - 1);
+}
+
+bool fibre_wait_fd(int fd, uint32_t events)
+{
+	fibre_t *f = fibre_self();
+	bool registered = fd < fd_waiters_len && fd_waiters[fd].fibre;
+
+	struct pollfd pfd = { .fd = fd, .events = events };
+	if (0 != poll(&pfd, 1, 0)) {
+		if (registered && fd_waiters[fd].fibre == f)
+			drop_fd(fd);
+		return true;
+	}
+
+	int epfd = get_epoll_fd();
+	struct epoll_event ev = {
+		.events = events | EPOLLONESHOT,
+		.data.fd = fd
+	};
+	int op = registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (0 != epoll_ctl(epfd, op, fd, &ev)) {
+		/* the descriptor may have been closed and reopened */
+		op = registered ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+		if ((ENOENT != errno && EEXIST != errno) ||
+		    0 != epoll_ctl(epfd, op, fd, &ev))
+			return true; /* cannot wait; let the caller discover the error */
+	}
+
+	if (fd >= fd_waiters_len)
+		grow_fd_waiters(fd);
+	if (fd_waiters[fd].fibre != f) {
+		/* only the most recent waiter is woken */
+		if (fd_waiters[fd].fibre)
+			unlink_fd(fd);
+		fd_waiters[fd].fibre = f;
+		fd_waiters[fd].next = f->wait_fd;
+		f->wait_fd = fd + 1;
+	}
+
+	return false;
+}
+
+static int open_poll_fd(struct wakeup_fds *fds)
+{
+	int epfd = get_epoll_fd();
+	struct epoll_event ev = { .events = EPOLLIN, .data.fd = fds->rd };
+	int res = epoll_ctl(epfd, EPOLL_CTL_ADD, fds->rd, &ev);
+	assert(0 == res);
+	(void) res;
+
+	return epfd;
+}
+
+static void dispatch(struct wakeup_fds *fds)
+{
+	struct epoll_event events[16];
+	int n;
+
+	do {
+		n = epoll_wait(epoll_fd, events, lengthof(events), 0);
+		for (int i=0; i<n; i++) {
+			int fd = events[i].data.fd;
+
+			if (fd == fds->rd) {
+				drain(fds);
+			} else if (fd < fd_waiters_len && fd_waiters[fd].fibre) {
+				fibre_t *f = fd_waiters[fd].fibre;
+				drop_fd(fd);
+				fibre_run(f);
+			}
+		}
+	} while (n == lengthof(events));
+}
+#else
+static int open_poll_fd(struct wakeup_fds *fds)
+{
+	return fds->rd;
+}
+
+static void dispatch(struct wakeup_fds *fds)
+{
+	drain(fds);
+}
+#endif
+
 void fibre_scheduler_main_loop()
 {
+	struct wakeup_fds fds;
+
+	open_wakeup_fds(&fds);
+	fibre_scheduler_set_wakeup(wakeup, &fds);
+	int poll_fd = open_poll_fd(&fds);
+	uint32_t last_dispatch = time_now();
+
 	while (true) {
 		uint32_t sleep_until = fibre_scheduler_next(time_now());
-		int32_t sleep_interval = cyclecmp32(sleep_until, time_now());
-		sleep_interval = sleep_interval < 1000 ? sleep_interval : 50000;
-		if (sleep_interval > 0)
-			usleep(sleep_interval);
+		uint32_t now = time_now();
+		int32_t sleep_interval = cyclecmp32(sleep_until, now);
+
+		if (sleep_interval <= 0) {
+			/* remain responsive to I/O even when the system is busy */
+			if (cyclecmp32(now, last_dispatch) >= 1000) {
+				dispatch(&fds);
+				last_dispatch = now;
+			}
+			continue;
+		}
+
+		if (!fibre_scheduler_sleep_begin())
+			continue;
+
+		/*
+		 * ppoll() is used (rather than epoll_wait()) because it offers
+		 * a microsecond resolution timeout. The epoll fd is itself
+		 * pollable so we lose nothing by doing so. Without ppoll() we
+		 * round up to whole milliseconds so we never wake early.
+		 */
+		struct pollfd pfd = { .fd = poll_fd, .events = POLLIN };
+#ifdef HAVE_PPOLL
+		struct timespec timeout = {
+			.tv_sec = sleep_interval / 1000000,
+			.tv_nsec = (sleep_interval % 1000000) * 1000
+		};
+		int ready = ppoll(&pfd, 1, &timeout, NULL);
+#else
+		int ready = poll(&pfd, 1, sleep_interval / 1000 +
+					  (sleep_interval % 1000 != 0));
+#endif
+
+		fibre_scheduler_sleep_end();
+		if (ready > 0)
+			dispatch(&fds);
+		last_dispatch = time_now();
+	}
+}
+
+#ifdef CONFIG_FIBRE_SMP
+static void *worker_thread(void *unused)
+{
+	bool attached = fibre_scheduler_attach();
+	assert(attached);
+	(void) attached;
+
+	fibre_scheduler_main_loop();
+	return NULL;
+}
+
+void fibre_scheduler_main_loop_smp(unsigned int nthreads)
+{
+	for (unsigned int i=1; i<nthreads; i++) {
+		pthread_t thread;
+		int res = pthread_create(&thread, NULL, worker_thread, NULL);
+		assert(0 == res);
+		(void) res;
 	}
+
+	fibre_scheduler_main_loop();
 }
+#endif
@@ -0,0 +1,97 @@
+/*
+ * messageq_posix.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/messageq.h"
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "librfn/time.h"
+#include "librfn/util.h"
+
+static void futex_wait(atomic_uint *uaddr, unsigned int val, uint32_t timeout)
+{
+	struct timespec ts = {
+		.tv_sec = timeout / 1000000,
+		.tv_nsec = (timeout % 1000000) * 1000
+	};
+
+	(void) syscall(SYS_futex, uaddr, FUTEX_WAIT_PRIVATE, val,
+		       timeout == MESSAGEQ_WAIT_FOREVER ? NULL : &ts, NULL, 0);
+}
+
+static void futex_wake(atomic_uint *uaddr)
+{
+	(void) syscall(SYS_futex, uaddr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL,
+		       NULL, 0);
+}
+
+void messageq_wake(messageq_t *mq)
+{
+	atomic_fetch_add(&mq->wake_seq, 1);
+	futex_wake(&mq->wake_seq);
+}
+
+/*
+ * Run op until it succeeds or the timeout expires. The uncontended case
+ * never leaves the first call to op.
+ */
+static void *wait_for(messageq_t *mq, void *(*op)(messageq_t *),
+		      uint32_t timeout)
+{
+	void *msg = op(mq);
+	if (msg || !timeout)
+		return msg;
+
+	/*
+	 * Track the time elapsed rather than comparing against a deadline;
+	 * cyclecmp32() cannot order a deadline more than 2^31 us ahead.
+	 */
+	uint32_t start = time_now();
+
+	atomic_fetch_add(&mq->waiters, 1);
+	while (true) {
+		/* sample wake_seq *before* retrying so no wake up is lost */
+		unsigned int seq = atomic_load(&mq->wake_seq);
+
+		msg = op(mq);
+		if (msg)
+			break;
+
+		uint32_t remaining = MESSAGEQ_WAIT_FOREVER;
+		if (timeout != MESSAGEQ_WAIT_FOREVER) {
+			uint32_t elapsed = time_now() - start;
+			if (elapsed >= timeout)
+				break;
+			remaining = timeout - elapsed;
+		}
+
+		futex_wait(&mq->wake_seq, seq, remaining);
+	}
+	atomic_fetch_sub(&mq->waiters, 1);
+
+	return msg;
+}
+
+void *messageq_claim_wait(messageq_t *mq, uint32_t timeout)
+{
+	return wait_for(mq, messageq_claim, timeout);
+}
+
+void *messageq_receive_wait(messageq_t *mq, uint32_t timeout)
+{
+	return wait_for(mq, messageq_receive, timeout);
+}
@@ -0,0 +1,192 @@
+/*
+ * stackfibre_posix.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/stackfibre.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "librfn/util.h"
+
+#ifndef CONFIG_FIBRE_JOIN
+#error stackful fibres require CONFIG_FIBRE_JOIN (to recycle killed stacks)
+#endif
+
+/*
+ * The bookkeeping for each stack lives at the top of the mapping with the
+ * stack itself growing down towards the guard page:
+ *
+ *   | guard page | stack ...... | struct stackfibre_stack |
+ */
+struct stackfibre_stack {
+	ucontext_t ctx;
+	ucontext_t *sched;
+	int state;
+	struct stackfibre_stack *next_free;
+	void *base;
+};
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stackfibre_stack *pool;
+
+static size_t page_size(void)
+{
+	static size_t pagesz;
+
+	if (!pagesz)
+		pagesz = sysconf(_SC_PAGESIZE);
+	return pagesz;
+}
+
+static size_t mapping_size(void)
+{
+	size_t pagesz = page_size();
+	size_t sz = CONFIG_STACKFIBRE_STACK_SIZE +
+		    sizeof(struct stackfibre_stack) + pagesz;
+
+	return (sz + pagesz - 1) & ~(pagesz - 1);
+}
+
+static struct stackfibre_stack *alloc_stack(void)
+{
+	struct stackfibre_stack *stack;
+
+	pthread_mutex_lock(&pool_lock);
+	stack = pool;
+	if (stack)
+		pool = stack->next_free;
+	pthread_mutex_unlock(&pool_lock);
+	if (stack)
+		return stack;
+
+	size_t sz = mapping_size();
+	char *base = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		abort();
+	if (0 != mprotect(base, page_size(), PROT_NONE))
+		abort();
+
+	stack = (struct stackfibre_stack *) (base + sz) - 1;
+	stack->base = base;
+	return stack;
+}
+
+static void free_stack(struct stackfibre_stack *stack)
+{
+	pthread_mutex_lock(&pool_lock);
+	stack->next_free = pool;
+	pool = stack;
+	pthread_mutex_unlock(&pool_lock);
+}
+
+static void suspend(int state)
+{
+	stackfibre_t *sf = containerof(fibre_self(), stackfibre_t, fibre);
+	struct stackfibre_stack *stack = sf->stack;
+
+	stack->state = state;
+	swapcontext(&stack->ctx, stack->sched);
+}
+
+static void entry(void)
+{
+	stackfibre_t *sf = containerof(fibre_self(), stackfibre_t, fibre);
+
+	sf->fn(sf->arg);
+
+	/* the trampoline will release the stack once we have left it */
+	sf->stack->state = PT_EXITED;
+	setcontext(sf->stack->sched);
+}
+
+/* a killed fibre will never resume so its stack can be recycled */
+static void release_stack(fibre_t *f, int state)
+{
+	stackfibre_t *sf = containerof(f, stackfibre_t, fibre);
+	struct stackfibre_stack *stack = sf->stack;
+
+	(void) state;
+
+	/* a fibre cannot give up the stack it is running on */
+	if (!stack || stack->sched)
+		return;
+
+	sf->stack = NULL;
+	free_stack(stack);
+}
+
+int stackfibre_trampoline(fibre_t *f)
+{
+	stackfibre_t *sf = containerof(f, stackfibre_t, fibre);
+	struct stackfibre_stack *stack = sf->stack;
+	ucontext_t sched;
+
+	if (!stack) {
+		stack = sf->stack = alloc_stack();
+		fibre_set_cleanup_handler(f, release_stack);
+
+		getcontext(&stack->ctx);
+		stack->ctx.uc_stack.ss_sp = (char *) stack->base + page_size();
+		stack->ctx.uc_stack.ss_size =
+		    (char *) stack - (char *) stack->ctx.uc_stack.ss_sp;
+		stack->ctx.uc_link = NULL;
+		makecontext(&stack->ctx, entry, 0);
+	}
+
+	/*
+	 * The scheduler context is recorded every time we switch in because
+	 * a fibre may be resumed by a different worker thread. It is cleared
+	 * again once we have left the stack.
+	 */
+	stack->sched = &sched;
+	swapcontext(&sched, &stack->ctx);
+	stack->sched = NULL;
+
+	int state = stack->state;
+	if (state == PT_EXITED) {
+		sf->stack = NULL;
+		free_stack(stack);
+	}
+
+	return state;
+}
+
+void stackfibre_init(stackfibre_t *sf, stackfibre_entrypoint_t *fn,
+		     void *arg)
+{
+	memset(sf, 0, sizeof(*sf));
+	fibre_init(&sf->fibre, stackfibre_trampoline);
+	sf->fn = fn;
+	sf->arg = arg;
+}
+
+void stackfibre_yield(void)
+{
+	suspend(PT_YIELDED);
+}
+
+void stackfibre_wait(void)
+{
+	suspend(PT_WAITING);
+}
+
+void stackfibre_sleep(uint32_t duetime)
+{
+	STACKFIBRE_WAIT_UNTIL(fibre_timeout(duetime));
+}
@@ -0,0 +1,312 @@
+/*
+ * rbtree.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/rbtree.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/*
+ * The insertion and removal algorithms are the top-down variants described
+ * by Julienne Walker. Neither needs parent pointers: insertion splits
+ * 4-nodes on the way down and removal pushes a red node down ahead of the
+ * search so the node finally unlinked is always red (or the root).
+ *
+ * Both algorithms start from a dummy node whose right child is the root so
+ * that rotations at the root need no special case. Child pointers are
+ * addressed by direction (0 is left, 1 is right) to avoid duplicating the
+ * mirror image cases.
+ */
+
+static inline bintree_node_t **link(rbtree_node_t *node, int dir)
+{
+	return dir ? &node->bintree.right : &node->bintree.left;
+}
+
+static inline rbtree_node_t *child(rbtree_node_t *node, int dir)
+{
+	return rbtree_from_bintree(*link(node, dir));
+}
+
+static inline void set_child(rbtree_node_t *node, int dir,
+			     rbtree_node_t *c)
+{
+	*link(node, dir) = c ? &c->bintree : NULL;
+}
+
+static inline bool is_red(rbtree_node_t *node)
+{
+	return node && node->red;
+}
+
+static rbtree_node_t *rotate(rbtree_node_t *root, int dir)
+{
+	rbtree_node_t *save = child(root, !dir);
+
+	set_child(root, !dir, child(save, dir));
+	set_child(save, dir, root);
+	root->red = true;
+	save->red = false;
+
+	return save;
+}
+
+static rbtree_node_t *rotate_double(rbtree_node_t *root, int dir)
+{
+	set_child(root, !dir, rotate(child(root, !dir), !dir));
+	return rotate(root, dir);
+}
+
+rbtree_node_t *rbtree_insert(rbtree_t *tree, rbtree_node_t *node,
+			     const void *key, rbtree_key_compare_t *keycmp)
+{
+	rbtree_node_t head = RBTREE_NODE_VAR_INIT;
+	rbtree_node_t *t, *g, *p, *q;
+	rbtree_node_t *existing = NULL;
+	int dir = 0, last = 0;
+
+	assert(bintree_is_leaf(&node->bintree));
+	node->red = true;
+
+	/* t, g, p and q are the great-grandparent, grandparent, parent and
+	 * current node respectively
+	 */
+	t = &head;
+	g = p = NULL;
+	head.bintree.right = tree->root;
+	q = child(t, 1);
+
+	while (true) {
+		if (!q) {
+			/* insert the new node at the bottom */
+			q = node;
+			set_child(p ? p : t, p ? dir : 1, q);
+		} else if (is_red(child(q, 0)) && is_red(child(q, 1))) {
+			/* colour flip */
+			q->red = true;
+			child(q, 0)->red = false;
+			child(q, 1)->red = false;
+		}
+
+		/* fix any red violation */
+		if (is_red(q) && is_red(p)) {
+			int dir2 = child(t, 1) == g;
+
+			if (q == child(p, last))
+				set_child(t, dir2, rotate(g, !last));
+			else
+				set_child(t, dir2, rotate_double(g, !last));
+		}
+
+		if (q == node)
+			break;
+
+		int cmp = keycmp(key, q);
+		if (cmp == 0) {
+			existing = q;
+			break;
+		}
+
+		last = dir;
+		dir = cmp > 0;
+
+		if (g)
+			t = g;
+		g = p;
+		p = q;
+		q = child(q, dir);
+	}
+
+	tree->root = head.bintree.right;
+	rbtree_from_bintree(tree->root)->red = false;
+
+	return existing;
+}
+
+/* find the parent of node, which must be in the tree, (head if it is the root) */
+static rbtree_node_t *find_parent(rbtree_node_t *head, rbtree_node_t *node,
+				  const void *key, rbtree_key_compare_t *keycmp)
+{
+	rbtree_node_t *p = head;
+	int dir = 1;
+
+	while (child(p, dir) != node) {
+		p = child(p, dir);
+		dir = keycmp(key, p) > 0;
+	}
+
+	return p;
+}
+
+rbtree_node_t *rbtree_remove(rbtree_t *tree, const void *key,
+			     rbtree_key_compare_t *keycmp)
+{
+	rbtree_node_t head = RBTREE_NODE_VAR_INIT;
+	rbtree_node_t *q, *p, *g, *f = NULL;
+	int dir = 1;
+
+	if (!tree->root)
+		return NULL;
+
+	q = &head;
+	g = p = NULL;
+	head.bintree.right = tree->root;
+
+	/* search for the node (f) and its in-order predecessor (q), pushing a
+	 * red node down as we go
+	 */
+	while (child(q, dir)) {
+		int last = dir;
+
+		g = p;
+		p = q;
+		q = child(q, dir);
+
+		int cmp = f ? 1 : keycmp(key, q);
+		if (cmp == 0)
+			f = q;
+		dir = cmp > 0;
+
+		if (is_red(q) || is_red(child(q, dir)))
+			continue;
+
+		if (is_red(child(q, !dir))) {
+			rbtree_node_t *r = rotate(q, dir);
+			set_child(p, last, r);
+			p = r;
+		} else {
+			rbtree_node_t *s = child(p, !last);
+
+			if (!s)
+				continue;
+
+			if (!is_red(child(s, !last)) && !is_red(child(s, last))) {
+				/* colour flip */
+				p->red = false;
+				s->red = true;
+				q->red = true;
+			} else {
+				int dir2 = child(g, 1) == p;
+				rbtree_node_t *r;
+
+				if (is_red(child(s, last)))
+					r = rotate_double(p, last);
+				else
+					r = rotate(p, last);
+				set_child(g, dir2, r);
+
+				/* ensure correct colouring */
+				q->red = r->red = true;
+				child(r, 0)->red = false;
+				child(r, 1)->red = false;
+			}
+		}
+	}
+
+	if (f) {
+		/* unlink q, which has at most one child */
+		set_child(p, child(p, 1) == q, child(q, !child(q, 0)));
+
+		/* nodes cannot be copied so, if f is not the node we just
+		 * unlinked, q must take its place in the tree
+		 */
+		if (f != q) {
+			rbtree_node_t *fp = find_parent(&head, f, key, keycmp);
+
+			q->bintree = f->bintree;
+			q->red = f->red;
+			set_child(fp, child(fp, 1) == f, q);
+		}
+
+		f->bintree.left = f->bintree.right = NULL;
+		f->red = false;
+	}
+
+	tree->root = head.bintree.right;
+	if (tree->root)
+		rbtree_from_bintree(tree->root)->red = false;
+
+	return f;
+}
+
+rbtree_node_t *rbtree_find(rbtree_t *tree, const void *key,
+			   rbtree_key_compare_t *keycmp)
+{
+	rbtree_node_t *q = rbtree_from_bintree(tree->root);
+
+	while (q) {
+		int cmp = keycmp(key, q);
+		if (cmp == 0)
+			break;
+		q = child(q, cmp > 0);
+	}
+
+	return q;
+}
+
+rbtree_node_t *rbtree_lower_bound(rbtree_t *tree, const void *key,
+				  rbtree_key_compare_t *keycmp)
+{
+	rbtree_node_t *q = rbtree_from_bintree(tree->root);
+	rbtree_node_t *bound = NULL;
+
+	while (q) {
+		if (keycmp(key, q) <= 0) {
+			bound = q;
+			q = child(q, 0);
+		} else {
+			q = child(q, 1);
+		}
+	}
+
+	return bound;
+}
+
+rbtree_node_t *rbtree_upper_bound(rbtree_t *tree, const void *key,
+				  rbtree_key_compare_t *keycmp)
+{
+	rbtree_node_t *q = rbtree_from_bintree(tree->root);
+	rbtree_node_t *bound = NULL;
+
+	while (q) {
+		if (keycmp(key, q) < 0) {
+			bound = q;
+			q = child(q, 0);
+		} else {
+			q = child(q, 1);
+		}
+	}
+
+	return bound;
+}
+
+static rbtree_node_t *extreme(rbtree_t *tree, int dir)
+{
+	rbtree_node_t *q = rbtree_from_bintree(tree->root);
+
+	if (q)
+		while (child(q, dir))
+			q = child(q, dir);
+
+	return q;
+}
+
+rbtree_node_t *rbtree_first(rbtree_t *tree)
+{
+	return extreme(tree, 0);
+}
+
+rbtree_node_t *rbtree_last(rbtree_t *tree)
+{
+	return extreme(tree, 1);
+}
@@ -0,0 +1,126 @@
+/*
+ * recordq.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/recordq.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Each record is preceded by a header containing its length. A header
+ * containing WRAP_MARKER tells the receiver that the next record is at the
+ * start of the buffer.
+ *
+ * readp and writep are byte offsets into the buffer. The sender never
+ * allows writep to catch up with readp so readp == writep means the queue
+ * is empty.
+ */
+#define HDR_LEN sizeof(uint32_t)
+#define WRAP_MARKER UINT32_MAX
+
+static inline uint32_t record_size(size_t len)
+{
+	return (HDR_LEN + len + RECORDQ_ALIGN - 1) & ~(RECORDQ_ALIGN - 1);
+}
+
+static inline uint32_t *header(recordq_t *q, uint32_t offset)
+{
+	return (uint32_t *) (q->basep + offset);
+}
+
+static inline uint32_t record_offset(recordq_t *q, void *rec)
+{
+	uint32_t offset = ((char *) rec) - q->basep - HDR_LEN;
+	assert(offset < q->buf_len);
+	return offset;
+}
+
+void recordq_init(recordq_t *q, void *basep, size_t buf_len)
+{
+	memset(q, 0, sizeof(*q));
+
+	q->basep = basep;
+	q->buf_len = buf_len & ~(RECORDQ_ALIGN - 1);
+}
+
+void *recordq_reserve(recordq_t *q, size_t len)
+{
+	uint32_t writep = atomic_load_explicit(&q->writep, memory_order_relaxed);
+	uint32_t readp = atomic_load_explicit(&q->readp, memory_order_acquire);
+
+	if (len >= q->buf_len)
+		return NULL;
+	uint32_t size = record_size(len);
+
+	if (writep >= readp) {
+		uint32_t tail = q->buf_len - writep;
+
+		/* filling the tail exactly wraps writep to zero */
+		if (size < tail || (size == tail && readp != 0))
+			return q->basep + writep + HDR_LEN;
+
+		/* skip the tail and try the start of the buffer */
+		if (size >= readp)
+			return NULL;
+		*header(q, writep) = WRAP_MARKER;
+		return q->basep + HDR_LEN;
+	}
+
+	if (size >= readp - writep)
+		return NULL;
+	return q->basep + writep + HDR_LEN;
+}
+
+void recordq_commit(recordq_t *q, void *rec, size_t len)
+{
+	uint32_t offset = record_offset(q, rec);
+
+	if (!len)
+		return;
+
+	*header(q, offset) = len;
+	offset += record_size(len);
+	if (offset >= q->buf_len)
+		offset = 0;
+
+	atomic_store_explicit(&q->writep, offset, memory_order_release);
+}
+
+void *recordq_peek(recordq_t *q, size_t *len)
+{
+	uint32_t readp = atomic_load_explicit(&q->readp, memory_order_relaxed);
+	uint32_t writep = atomic_load_explicit(&q->writep, memory_order_acquire);
+
+	if (readp == writep)
+		return NULL;
+
+	uint32_t hdr = *header(q, readp);
+	if (hdr == WRAP_MARKER) {
+		readp = 0;
+		hdr = *header(q, readp);
+	}
+
+	*len = hdr;
+	return q->basep + readp + HDR_LEN;
+}
+
+void recordq_release(recordq_t *q, void *rec)
+{
+	uint32_t offset = record_offset(q, rec);
+
+	offset += record_size(*header(q, offset));
+	if (offset >= q->buf_len)
+		offset = 0;
+
+	atomic_store_explicit(&q->readp, offset, memory_order_release);
+}
@@ -27,51 +27,128 @@ void ringbuf_init(ringbuf_t *rb, void *bufp, size_t buf_len)
 	rb->buf_len = buf_len;
 }
 
-/* TODO: the memory ordering in this function is needlessly aggressive */
+/*
+ * Each index is written only by its owner so the owner can read it with a
+ * relaxed load. The other side's index is read with an acquire load that
+ * pairs with the release store that published it, ensuring the data (or
+ * the space) it covers is visible before we use it.
+ */
 int ringbuf_get(ringbuf_t *rb)
 {
-	unsigned int readi = atomic_load(&rb->readi);
+	unsigned int readi =
+	    atomic_load_explicit(&rb->readi, memory_order_relaxed);
 	int d;
 
 	assert(readi < rb->buf_len);
 
-	if (readi == atomic_load(&rb->writei))
+	if (readi == atomic_load_explicit(&rb->writei, memory_order_acquire))
 		return -1;
 
 	d = rb->bufp[readi];
-	atomic_signal_fence(memory_order_seq_cst);
 
 	if (++readi >= rb->buf_len)
 		readi -= rb->buf_len;
 
-	atomic_store(&rb->readi, readi);
+	atomic_store_explicit(&rb->readi, readi, memory_order_release);
 	return d;
 }
 
-/* TODO: the memory ordering in this function is needlessly aggressive */
 bool ringbuf_empty(ringbuf_t *rb)
 {
-	return atomic_load(&rb->readi) == atomic_load(&rb->writei);
+	return atomic_load_explicit(&rb->readi, memory_order_relaxed) ==
+	       atomic_load_explicit(&rb->writei, memory_order_relaxed);
 }
 
-/* TODO: the memory ordering in this function is needlessly aggressive */
 bool ringbuf_put(ringbuf_t *rb, uint8_t d)
 {
-	unsigned int writei = atomic_load(&rb->writei);
+	unsigned int writei =
+	    atomic_load_explicit(&rb->writei, memory_order_relaxed);
 	unsigned int old_writei = writei;
 
 	if (++writei >= rb->buf_len)
 		writei -= rb->buf_len;
-	
-	if (writei == atomic_load(&rb->readi))
+
+	if (writei == atomic_load_explicit(&rb->readi, memory_order_acquire))
 		return false;
-	
+
 	rb->bufp[old_writei] = d;
-	atomic_signal_fence(memory_order_seq_cst);
-	atomic_store(&rb->writei, writei);
+	atomic_store_explicit(&rb->writei, writei, memory_order_release);
 	return true;
 }
 
+size_t ringbuf_write(ringbuf_t *rb, const void *p, size_t n)
+{
+	unsigned int writei =
+	    atomic_load_explicit(&rb->writei, memory_order_relaxed);
+	unsigned int readi =
+	    atomic_load_explicit(&rb->readi, memory_order_acquire);
+	const uint8_t *src = p;
+
+	/* one byte is always left empty to distinguish full from empty */
+	size_t space = (readi > writei ? readi : readi + rb->buf_len) -
+		       writei - 1;
+	if (n > space)
+		n = space;
+
+	size_t first = rb->buf_len - writei;
+	if (first > n)
+		first = n;
+	memcpy(rb->bufp + writei, src, first);
+	memcpy(rb->bufp, src + first, n - first);
+
+	writei += n;
+	if (writei >= rb->buf_len)
+		writei -= rb->buf_len;
+	atomic_store_explicit(&rb->writei, writei, memory_order_release);
+
+	return n;
+}
+
+size_t ringbuf_read(ringbuf_t *rb, void *p, size_t n)
+{
+	uint8_t *dst = p;
+	size_t total = 0;
+
+	/* at most two passes are needed since each reaches the wrap point */
+	for (int i=0; i<2 && n; i++) {
+		size_t avail;
+		uint8_t *src = ringbuf_peek_contig(rb, &avail);
+		if (avail > n)
+			avail = n;
+
+		memcpy(dst, src, avail);
+		ringbuf_consume(rb, avail);
+		dst += avail;
+		total += avail;
+		n -= avail;
+	}
+
+	return total;
+}
+
+uint8_t *ringbuf_peek_contig(ringbuf_t *rb, size_t *n)
+{
+	unsigned int readi =
+	    atomic_load_explicit(&rb->readi, memory_order_relaxed);
+	unsigned int writei =
+	    atomic_load_explicit(&rb->writei, memory_order_acquire);
+
+	*n = (writei >= readi ? writei : rb->buf_len) - readi;
+	return rb->bufp + readi;
+}
+
+void ringbuf_consume(ringbuf_t *rb, size_t n)
+{
+	unsigned int readi =
+	    atomic_load_explicit(&rb->readi, memory_order_relaxed);
+
+	readi += n;
+	if (readi >= rb->buf_len)
+		readi -= rb->buf_len;
+
+	atomic_store_explicit(&rb->readi, readi, memory_order_release);
+}
+
 void ringbuf_putchar(void *rb, char c)
 {
 	while (!ringbuf_put(rb, c))
@@ -0,0 +1,133 @@
+/*
+ * spscring.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "librfn/spscring.h"
+
+#include <assert.h>
+#include <string.h>
+
+void spscring_init(spscring_t *rb, void *bufp, size_t buf_len)
+{
+	/* buffer length must be a power of two */
+	assert(buf_len && 0 == (buf_len & (buf_len - 1)));
+
+	memset(rb, 0, sizeof(*rb));
+
+	rb->bufp = bufp;
+	rb->mask = buf_len - 1;
+}
+
+/*
+ * Number of bytes the producer can write. The consumer's index is only
+ * re-read when the cached copy is not sufficient.
+ */
+static inline uint32_t write_space(spscring_t *rb, uint32_t writei,
+				   uint32_t want)
+{
+	uint32_t space = rb->mask + 1 - (writei - rb->cached_readi);
+
+	if (space < want) {
+		rb->cached_readi =
+		    atomic_load_explicit(&rb->readi, memory_order_acquire);
+		space = rb->mask + 1 - (writei - rb->cached_readi);
+	}
+
+	return space;
+}
+
+/* Number of bytes the consumer can read (see write_space()) */
+static inline uint32_t read_avail(spscring_t *rb, uint32_t readi,
+				  uint32_t want)
+{
+	uint32_t avail = rb->cached_writei - readi;
+
+	if (avail < want) {
+		rb->cached_writei =
+		    atomic_load_explicit(&rb->writei, memory_order_acquire);
+		avail = rb->cached_writei - readi;
+	}
+
+	return avail;
+}
+
+int spscring_get(spscring_t *rb)
+{
+	uint32_t readi = atomic_load_explicit(&rb->readi, memory_order_relaxed);
+
+	if (!read_avail(rb, readi, 1))
+		return -1;
+
+	int d = rb->bufp[readi & rb->mask];
+	atomic_store_explicit(&rb->readi, readi + 1, memory_order_release);
+	return d;
+}
+
+bool spscring_put(spscring_t *rb, uint8_t d)
+{
+	uint32_t writei =
+	    atomic_load_explicit(&rb->writei, memory_order_relaxed);
+
+	if (!write_space(rb, writei, 1))
+		return false;
+
+	rb->bufp[writei & rb->mask] = d;
+	atomic_store_explicit(&rb->writei, writei + 1, memory_order_release);
+	return true;
+}
+
+bool spscring_empty(spscring_t *rb)
+{
+	return atomic_load_explicit(&rb->readi, memory_order_relaxed) ==
+	       atomic_load_explicit(&rb->writei, memory_order_relaxed);
+}
+
+size_t spscring_write(spscring_t *rb, const void *p, size_t n)
+{
+	uint32_t writei =
+	    atomic_load_explicit(&rb->writei, memory_order_relaxed);
+	uint32_t space = write_space(rb, writei, n);
+	uint32_t offset = writei & rb->mask;
+	const uint8_t *src = p;
+
+	if (n > space)
+		n = space;
+
+	size_t first = rb->mask + 1 - offset;
+	if (first > n)
+		first = n;
+	memcpy(rb->bufp + offset, src, first);
+	memcpy(rb->bufp, src + first, n - first);
+
+	atomic_store_explicit(&rb->writei, writei + n, memory_order_release);
+	return n;
+}
+
+size_t spscring_read(spscring_t *rb, void *p, size_t n)
+{
+	uint32_t readi = atomic_load_explicit(&rb->readi, memory_order_relaxed);
+	uint32_t avail = read_avail(rb, readi, n);
+	uint32_t offset = readi & rb->mask;
+	uint8_t *dst = p;
+
+	if (n > avail)
+		n = avail;
+
+	size_t first = rb->mask + 1 - offset;
+	if (first > n)
+		first = n;
+	memcpy(dst, rb->bufp + offset, first);
+	memcpy(dst + first, rb->bufp, n - first);
+
+	atomic_store_explicit(&rb->readi, readi + n, memory_order_release);
+	return n;
+}
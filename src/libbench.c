@@ -15,6 +15,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "librfn.h"
 #include "libbench.h"
 
@@ -31,6 +36,22 @@
 #define NUM_CYCLES 1000000
 #endif
 
+/*
+ * The timer benchmarks are much more expensive per cycle so we run fewer
+ * cycles and scale the results to match the other benchmarks.
+ */
+#define TIMER_SCALE 100
+#define TIMER_CYCLES (NUM_CYCLES / TIMER_SCALE)
+
+/*
+ * Sleeping fibres are spread over the second starting at TIMER_OFFSET and the
+ * benchmark fibres sleep in the middle of them. Nobody ever wakes up because
+ * of a timeout; the benchmark exists to measure the cost of timer queue
+ * insertion and removal as the queue gets deeper.
+ */
+#define TIMER_OFFSET 10000000
+#define MAX_SLEEPERS 1000
+
 static fibre_t *next_action;
 
 typedef struct {
@@ -105,6 +126,145 @@ static int atomic_run_fibre(fibre_t *fibre)
 	PT_END();
 }
 
+static int timer_run_fibre(fibre_t *fibre)
+{
+	benchmark_fibre_t *bm = containerof(fibre, benchmark_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(fibre);
+
+	bm->start_time = time_now();
+	bm->count = 0;
+
+	while (bm->count++ < bm->cycles) {
+		fibre_run(bm->friend);
+		(void) fibre_timeout(time_now() + TIMER_OFFSET + 500000);
+		PT_WAIT();
+	}
+
+	/* if we are fibre[0] we need to poke fibre[1] one last time */
+	if (bm->friend > fibre)
+		fibre_run(bm->friend);
+
+	bm->end_time = time_now();
+	fibre_run(next_action);
+	PT_END();
+}
+
+#ifdef HAVE_UCONTEXT_H
+/* stackful equivalent of yield_fibre() */
+static void stack_yield_fibre(void *arg)
+{
+	benchmark_fibre_t *bm = arg;
+
+	bm->start_time = time_now();
+	bm->count = 0;
+
+	while (bm->count++ < bm->cycles)
+		stackfibre_yield();
+
+	bm->end_time = time_now();
+	fibre_run(next_action);
+}
+#endif
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * The ring buffer benchmarks pass NUM_CYCLES bytes, one at a time, from a
+ * producer thread to the benchmark thread. These run synchronously (and
+ * block the fibre scheduler) since the cost of interest is the cache line
+ * traffic between the two CPUs. The threads yield when the ring is full (or
+ * empty) so that the benchmark completes on uniprocessor systems.
+ */
+static uint8_t ringbuf_buf[1024];
+static ringbuf_t ringbuf = RINGBUF_VAR_INIT(ringbuf_buf, sizeof(ringbuf_buf));
+static uint8_t spscring_buf[1024];
+static spscring_t spscring =
+    SPSCRING_VAR_INIT(spscring_buf, sizeof(spscring_buf));
+
+static void *ringbuf_producer(void *arg)
+{
+	for (int i=0; i<NUM_CYCLES; i++)
+		while (!ringbuf_put(&ringbuf, i))
+			sched_yield();
+
+	return arg;
+}
+
+static uint32_t ringbuf_transfer(void)
+{
+	uint32_t start_time = time_now();
+	pthread_t producer;
+
+	if (0 != pthread_create(&producer, NULL, ringbuf_producer, NULL))
+		return 0;
+	for (int i=0; i<NUM_CYCLES; i++)
+		while (-1 == ringbuf_get(&ringbuf))
+			sched_yield();
+	pthread_join(producer, NULL);
+
+	return time_now() - start_time;
+}
+
+static void *spscring_producer(void *arg)
+{
+	for (int i=0; i<NUM_CYCLES; i++)
+		while (!spscring_put(&spscring, i))
+			sched_yield();
+
+	return arg;
+}
+
+static uint32_t spscring_transfer(void)
+{
+	uint32_t start_time = time_now();
+	pthread_t producer;
+
+	if (0 != pthread_create(&producer, NULL, spscring_producer, NULL))
+		return 0;
+	for (int i=0; i<NUM_CYCLES; i++)
+		while (-1 == spscring_get(&spscring))
+			sched_yield();
+	pthread_join(producer, NULL);
+
+	return time_now() - start_time;
+}
+#endif
+
+typedef struct {
+	uint32_t duetime;
+	fibre_t fibre;
+} sleeper_fibre_t;
+
+static int sleeper_fibre(fibre_t *fibre)
+{
+	sleeper_fibre_t *s = containerof(fibre, sleeper_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(fibre);
+	PT_WAIT_UNTIL(fibre_timeout(s->duetime));
+	PT_END();
+}
+
+static sleeper_fibre_t sleepers[MAX_SLEEPERS];
+
+static void start_sleepers(int n)
+{
+	uint32_t now = time_now();
+
+	for (int i=0; i<n; i++) {
+		fibre_init(&sleepers[i].fibre, sleeper_fibre);
+		sleepers[i].duetime = now + TIMER_OFFSET +
+				      ((i * 7919) % MAX_SLEEPERS) *
+					  (1000000 / MAX_SLEEPERS);
+		fibre_run(&sleepers[i].fibre);
+	}
+}
+
+static void stop_sleepers(int n)
+{
+	for (int i=0; i<n; i++)
+		(void) fibre_kill(&sleepers[i].fibre);
+}
+
 static benchmark_fibre_t single_yield = {
 	.cycles = NUM_CYCLES,
 	.fibre = FIBRE_VAR_INIT(yield_fibre)
@@ -148,6 +308,31 @@ static benchmark_fibre_t atomic_run[2] = {
 };
 
 
+static benchmark_fibre_t timer_run[2] = {
+	{
+		.cycles = TIMER_CYCLES/2,
+		.fibre = FIBRE_VAR_INIT(timer_run_fibre),
+		.friend = &timer_run[1].fibre,
+	},
+	{
+		.cycles = TIMER_CYCLES/2,
+		.fibre = FIBRE_VAR_INIT(timer_run_fibre),
+		.friend = &timer_run[0].fibre,
+	},
+};
+
+#ifdef HAVE_UCONTEXT_H
+static benchmark_fibre_t stack_paired_yield[2] = {
+	{ .cycles = NUM_CYCLES/2 },
+	{ .cycles = NUM_CYCLES/2 }
+};
+
+static stackfibre_t stack_paired[2] = {
+	STACKFIBRE_VAR_INIT(stack_yield_fibre, &stack_paired_yield[0]),
+	STACKFIBRE_VAR_INIT(stack_yield_fibre, &stack_paired_yield[1])
+};
+#endif
+
 void benchmark_init(benchmark_results_t *results, fibre_t *wakeup)
 {
 	memset(results, 0, sizeof(*results));
@@ -156,6 +341,8 @@ void benchmark_init(benchmark_results_t *results, fibre_t *wakeup)
 	results->wakeup = wakeup;
 }	
 
+static const int num_sleepers[] = { 10, 100, 1000 };
+
 int benchmark_run_once(benchmark_results_t *results)
 {
 	/* next_action is a bit of a hack but since it is meaningless to run
@@ -187,6 +374,32 @@ int benchmark_run_once(benchmark_results_t *results)
 	stats_add(&results->stats[BENCHMARK_ATOMIC_RUN],
 		  atomic_run[1].end_time - atomic_run[0].start_time);
 
+	for (results->i = 0; results->i < lengthof(num_sleepers);
+	     results->i++) {
+		start_sleepers(num_sleepers[results->i]);
+		fibre_run(&timer_run[0].fibre);
+		PT_WAIT();
+		stop_sleepers(num_sleepers[results->i]);
+		stats_add(&results->stats[BENCHMARK_TIMER_10 + results->i],
+			  (timer_run[1].end_time - timer_run[0].start_time) *
+			      TIMER_SCALE);
+	}
+
+#ifdef HAVE_UCONTEXT_H
+	fibre_run(&stack_paired[0].fibre);
+	fibre_run(&stack_paired[1].fibre);
+	PT_WAIT();
+	stats_add(&results->stats[BENCHMARK_STACK_PAIRED],
+		  stack_paired_yield[1].end_time -
+		      stack_paired_yield[0].start_time);
+#endif
+
+#ifdef HAVE_PTHREAD_H
+	stats_add(&results->stats[BENCHMARK_RINGBUF_SMP], ringbuf_transfer());
+	stats_add(&results->stats[BENCHMARK_SPSCRING_SMP],
+		  spscring_transfer());
+#endif
+
 	PT_END();
 }
 
@@ -199,6 +412,16 @@ static const char *lookup_name(int n)
 	C(PAIRED);
 	C(SIMPLE_RUN);
 	C(ATOMIC_RUN);
+	C(TIMER_10);
+	C(TIMER_100);
+	C(TIMER_1000);
+#ifdef HAVE_UCONTEXT_H
+	C(STACK_PAIRED);
+#endif
+#ifdef HAVE_PTHREAD_H
+	C(RINGBUF_SMP);
+	C(SPSCRING_SMP);
+#endif
 	default:
 		return NULL;
 #undef C
@@ -34,11 +34,22 @@ enum {
 	BENCHMARK_PAIRED,
 	BENCHMARK_SIMPLE_RUN,
 	BENCHMARK_ATOMIC_RUN,
+	BENCHMARK_TIMER_10,
+	BENCHMARK_TIMER_100,
+	BENCHMARK_TIMER_1000,
+#ifdef HAVE_UCONTEXT_H
+	BENCHMARK_STACK_PAIRED,
+#endif
+#ifdef HAVE_PTHREAD_H
+	BENCHMARK_RINGBUF_SMP,
+	BENCHMARK_SPSCRING_SMP,
+#endif
 	BENCHMARK_MAX
 };
 
 typedef struct {
 	pt_t pt;
+	int i;
 	fibre_t *wakeup;
 	stats_t stats[BENCHMARK_MAX];
 } benchmark_results_t;
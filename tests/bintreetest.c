@@ -0,0 +1,238 @@
+/*
+ * bintreetest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+typedef struct {
+	bintree_node_t node;
+	int val;
+} tnode_t;
+
+static tnode_t *from_bintree(bintree_node_t *node)
+{
+	return node ? containerof(node, tnode_t, node) : NULL;
+}
+
+static bintree_node_t *to_bintree(tnode_t *node)
+{
+	return node ? &node->node : NULL;
+}
+
+static void free_node(bintree_node_t *node)
+{
+}
+
+BINTREE_DECLARE_INLINE_WRAPPERS(tnode, tnode_t, from_bintree, to_bintree,
+				free_node)
+
+/*
+ *         4
+ *       /   \
+ *      2     6
+ *     / \     \
+ *    1   3     8
+ *             /
+ *            7
+ */
+static tnode_t n[9];
+
+static tnode_t *make_tree()
+{
+	memset(n, 0, sizeof(n));
+	for (int i=0; i<lengthof(n); i++)
+		n[i].val = i;
+
+	n[4].node.left = &n[2].node;
+	n[4].node.right = &n[6].node;
+	n[2].node.left = &n[1].node;
+	n[2].node.right = &n[3].node;
+	n[6].node.right = &n[8].node;
+	n[8].node.left = &n[7].node;
+
+	return &n[4];
+}
+
+static const int in_order[] = { 1, 2, 3, 4, 6, 7, 8 };
+static const int pre_order[] = { 4, 2, 1, 3, 6, 8, 7 };
+static const int post_order[] = { 1, 3, 2, 7, 8, 6, 4 };
+
+/* snapshot of the tree used to prove the iterators do not modify it */
+static bintree_node_t snapshot[lengthof(n)];
+
+static void take_snapshot()
+{
+	for (int i=0; i<lengthof(n); i++)
+		snapshot[i] = n[i].node;
+}
+
+static bool unmodified()
+{
+	for (int i=0; i<lengthof(n); i++)
+		if (snapshot[i].left != n[i].node.left ||
+		    snapshot[i].right != n[i].node.right)
+			return false;
+	return true;
+}
+
+static void test_orders()
+{
+	tnode_t *tree = make_tree();
+	bintree_node_t *stack[4];
+	bintree_iterator_t iter;
+	tnode_t *p;
+	int i;
+
+	take_snapshot();
+
+	i = 0;
+	for (p = tnode_iterate_in_order_stack(&iter, tree, stack,
+					      lengthof(stack));
+	     p; p = tnode_next(&iter)) {
+		verify(p->val == in_order[i++]);
+		verify(unmodified());
+	}
+	verify(i == lengthof(in_order));
+
+	i = 0;
+	for (p = tnode_iterate_pre_order_stack(&iter, tree, stack,
+					       lengthof(stack));
+	     p; p = tnode_next(&iter)) {
+		verify(p->val == pre_order[i++]);
+		verify(unmodified());
+	}
+	verify(i == lengthof(pre_order));
+
+	i = 0;
+	for (p = tnode_iterate_post_order_stack(&iter, tree, stack,
+						lengthof(stack));
+	     p; p = tnode_next(&iter)) {
+		verify(p->val == post_order[i++]);
+		if (p == tree)
+			verify(NULL == iter.parent);
+		else
+			verify(iter.parent->left == &p->node ||
+			       iter.parent->right == &p->node);
+		verify(unmodified());
+	}
+	verify(i == lengthof(post_order));
+
+	/* the threading iterators visit the nodes in the same order */
+	i = 0;
+	for (p = tnode_iterate_in_order(&iter, tree); p; p = tnode_next(&iter))
+		verify(p->val == in_order[i++]);
+	i = 0;
+	for (p = tnode_iterate_pre_order(&iter, tree); p; p = tnode_next(&iter))
+		verify(p->val == pre_order[i++]);
+	i = 0;
+	for (p = tnode_iterate_post_order(&iter, tree); p;
+	     p = tnode_next(&iter))
+		verify(p->val == post_order[i++]);
+	verify(unmodified());
+
+	/* empty trees */
+	verify(NULL == bintree_iterate_in_order_stack(&iter, NULL, stack,
+						      lengthof(stack)));
+	verify(NULL == bintree_iterate_pre_order_stack(&iter, NULL, stack,
+						       lengthof(stack)));
+	verify(NULL == bintree_iterate_post_order_stack(&iter, NULL, stack,
+							lengthof(stack)));
+}
+
+static void test_concurrent()
+{
+	tnode_t *tree = make_tree();
+	bintree_node_t *stack[2][4];
+	bintree_iterator_t iter[2];
+	tnode_t *p, *q;
+
+	take_snapshot();
+
+	/* two readers, one of which starts late */
+	p = tnode_iterate_in_order_stack(&iter[0], tree, stack[0],
+					 lengthof(stack[0]));
+	verify(p->val == in_order[0]);
+	p = tnode_next(&iter[0]);
+	q = tnode_iterate_pre_order_stack(&iter[1], tree, stack[1],
+					  lengthof(stack[1]));
+	for (int i=1; i<lengthof(in_order); i++) {
+		verify(p->val == in_order[i]);
+		verify(q->val == pre_order[i-1]);
+		p = tnode_next(&iter[0]);
+		q = tnode_next(&iter[1]);
+	}
+	verify(!p && q->val == pre_order[lengthof(pre_order) - 1]);
+
+	/* abandon an iteration part way through */
+	p = tnode_iterate_post_order_stack(&iter[0], tree, stack[0],
+					   lengthof(stack[0]));
+	verify(p && p->val == post_order[0]);
+	tnode_iterate_complete(&iter[0]);
+	verify(NULL == tnode_next(&iter[0]));
+	verify(unmodified());
+}
+
+static void test_degenerate()
+{
+	static tnode_t chain[1000];
+	static bintree_node_t *stack[lengthof(chain)];
+	bintree_iterator_t iter;
+	tnode_t *p;
+	int i;
+
+	/* a left leaning chain (ending in a right child) */
+	memset(chain, 0, sizeof(chain));
+	for (i=0; i<lengthof(chain); i++) {
+		chain[i].val = i;
+		if (i < lengthof(chain) - 2)
+			chain[i].node.left = &chain[i+1].node;
+		else if (i == lengthof(chain) - 2)
+			chain[i].node.right = &chain[i+1].node;
+	}
+
+	i = 0;
+	for (p = tnode_iterate_in_order_stack(&iter, chain, stack,
+					      lengthof(stack));
+	     p; p = tnode_next(&iter))
+		i++;
+	verify(i == lengthof(chain));
+
+	/* pre-order needs no stack for a chain */
+	i = 0;
+	for (p = tnode_iterate_pre_order_stack(&iter, chain, stack, 1); p;
+	     p = tnode_next(&iter))
+		verify(p->val == i++);
+	verify(i == lengthof(chain));
+
+	i = lengthof(chain);
+	for (p = tnode_iterate_post_order_stack(&iter, chain, stack,
+						lengthof(stack));
+	     p; p = tnode_next(&iter))
+		verify(p->val == --i);
+	verify(i == 0);
+}
+
+int main()
+{
+	test_orders();
+	test_concurrent();
+	test_degenerate();
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * dlisttest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <librfn.h>
+
+/* check the list's links in both directions against an expected order */
+static bool check_list(dlist_t *list, dlist_node_t **expected, int n)
+{
+	dlist_node_t *node, *tmp;
+	int i = 0;
+
+	dlist_foreach(list, node, tmp) {
+		if (i >= n || node != expected[i])
+			return false;
+		i++;
+	}
+	if (i != n)
+		return false;
+
+	dlist_foreach_reverse(list, node, tmp) {
+		if (node != expected[--i])
+			return false;
+	}
+
+	return list->head == (n ? expected[0] : NULL) &&
+	       list->tail == (n ? expected[n-1] : NULL);
+}
+
+static void test_dlist_insert()
+{
+	dlist_t list = DLIST_VAR_INIT;
+	dlist_node_t n[4] = { DLIST_NODE_VAR_INIT };
+
+	verify(dlist_empty(&list));
+	verify(NULL == dlist_extract(&list));
+	verify(NULL == dlist_extract_tail(&list));
+
+	dlist_insert(&list, &n[1]);
+	dlist_insert(&list, &n[2]);
+	dlist_push(&list, &n[0]);
+	verify(check_list(&list, (dlist_node_t *[]) { &n[0], &n[1], &n[2] }, 3));
+	verify(&n[0] == dlist_peek(&list) && &n[2] == dlist_peek_tail(&list));
+
+	dlist_insert_after(&list, &n[2], &n[3]);
+	verify(check_list(&list,
+			  (dlist_node_t *[]) { &n[0], &n[1], &n[2], &n[3] }, 4));
+
+	verify(&n[0] == dlist_extract(&list));
+	verify(&n[3] == dlist_extract_tail(&list));
+	verify(check_list(&list, (dlist_node_t *[]) { &n[1], &n[2] }, 2));
+
+	dlist_insert_before(&list, &n[1], &n[0]);
+	dlist_insert_before(&list, &n[2], &n[3]);
+	verify(check_list(&list,
+			  (dlist_node_t *[]) { &n[0], &n[1], &n[3], &n[2] }, 4));
+
+	for (int i=0; i<lengthof(n); i++)
+		verify(dlist_contains(&list, &n[i]));
+}
+
+static void test_dlist_remove()
+{
+	dlist_t list = DLIST_VAR_INIT;
+	dlist_node_t n[3] = { DLIST_NODE_VAR_INIT };
+
+	for (int i=0; i<lengthof(n); i++)
+		dlist_insert(&list, &n[i]);
+
+	/* middle, tail and finally head */
+	dlist_remove(&list, &n[1]);
+	verify(check_list(&list, (dlist_node_t *[]) { &n[0], &n[2] }, 2));
+	verify(!dlist_contains(&list, &n[1]));
+	verify(!n[1].next && !n[1].prev);
+	dlist_remove(&list, &n[2]);
+	verify(check_list(&list, (dlist_node_t *[]) { &n[0] }, 1));
+	dlist_remove(&list, &n[0]);
+	verify(check_list(&list, NULL, 0));
+	verify(dlist_empty(&list));
+
+	/* removal during iteration (in both directions) */
+	dlist_node_t *node, *tmp;
+	for (int i=0; i<lengthof(n); i++)
+		dlist_insert(&list, &n[i]);
+	dlist_foreach(&list, node, tmp)
+		if (node != &n[1])
+			dlist_remove(&list, node);
+	verify(check_list(&list, (dlist_node_t *[]) { &n[1] }, 1));
+	dlist_insert(&list, &n[2]);
+	dlist_push(&list, &n[0]);
+	dlist_foreach_reverse(&list, node, tmp)
+		dlist_remove(&list, node);
+	verify(dlist_empty(&list));
+}
+
+static void test_dlist_splice()
+{
+	dlist_t a = DLIST_VAR_INIT, b = DLIST_VAR_INIT;
+	dlist_node_t n[4] = { DLIST_NODE_VAR_INIT };
+
+	/* splicing an empty list is harmless */
+	dlist_splice(&a, &b);
+	verify(dlist_empty(&a) && dlist_empty(&b));
+
+	/* splice into an empty list */
+	dlist_insert(&b, &n[0]);
+	dlist_insert(&b, &n[1]);
+	dlist_splice(&a, &b);
+	verify(dlist_empty(&b));
+	verify(check_list(&a, (dlist_node_t *[]) { &n[0], &n[1] }, 2));
+
+	/* splice onto the tail of a list */
+	dlist_insert(&b, &n[2]);
+	dlist_insert(&b, &n[3]);
+	dlist_splice(&a, &b);
+	verify(dlist_empty(&b));
+	verify(check_list(&a,
+			  (dlist_node_t *[]) { &n[0], &n[1], &n[2], &n[3] }, 4));
+}
+
+int main()
+{
+	test_dlist_insert();
+	test_dlist_remove();
+	test_dlist_splice();
+
+	return 0;
+}
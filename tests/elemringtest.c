@@ -0,0 +1,113 @@
+/*
+ * elemringtest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+typedef struct {
+	uint32_t timestamp;
+	int16_t x, y, z;
+} record_t;
+
+ELEMRING_DECLARE_INLINE_WRAPPERS(record_ring, record_t)
+ELEMRING_DECLARE_INLINE_WRAPPERS(sample_ring, int16_t)
+
+static void test_records()
+{
+	static record_t buf[4];
+	elemring_t r = ELEMRING_VAR_INIT(buf, sizeof(buf), sizeof(buf[0]));
+	elemring_t myr;
+	record_t rec = { 0 };
+
+	/* prove the equivalence of the initializer and the init fns */
+	elemring_init(&myr, buf, sizeof(buf), sizeof(buf[0]));
+	verify(0 == memcmp(&r, &myr, sizeof(r)));
+	record_ring_init(&myr, buf, lengthof(buf));
+	verify(0 == memcmp(&r, &myr, sizeof(r)));
+
+	verify(elemring_empty(&r));
+	verify(!record_ring_pop(&r, &rec));
+
+	/* becomes full after three pushes */
+	for (int i=0; i<3; i++) {
+		rec.timestamp = i;
+		rec.z = -i;
+		verify(record_ring_push(&r, &rec));
+	}
+	verify(!record_ring_push(&r, &rec));
+
+	/* pop/push/still full for all possible indices */
+	for (int i=0; i<8; i++) {
+		verify(record_ring_pop(&r, &rec));
+		verify(rec.timestamp == i && rec.z == -i);
+		rec.timestamp = i + 3;
+		rec.z = -(i + 3);
+		verify(record_ring_push(&r, &rec));
+		verify(!record_ring_push(&r, &rec));
+	}
+
+	for (int i=8; i<11; i++) {
+		verify(record_ring_pop(&r, &rec));
+		verify(rec.timestamp == i && rec.z == -i);
+	}
+	verify(elemring_empty(&r));
+}
+
+static void test_batch()
+{
+	static int16_t buf[10];
+	elemring_t r;
+	int16_t in[16], out[16];
+	int16_t next_in = 0, next_out = 0;
+
+	sample_ring_init(&r, buf, lengthof(buf));
+
+	/* batches of every size at every possible index */
+	for (int n=1; n<lengthof(in); n++) {
+		for (int i=0; i<lengthof(buf); i++) {
+			for (int j=0; j<n; j++)
+				in[j] = next_in + j;
+			size_t pushed = sample_ring_push_n(&r, in, n);
+			verify(pushed == (n < lengthof(buf) ? n : lengthof(buf) - 1));
+			next_in += pushed;
+
+			size_t popped = sample_ring_pop_n(&r, out, lengthof(out));
+			verify(popped == pushed);
+			for (int j=0; j<popped; j++)
+				verify(out[j] == next_out++);
+
+			/* keep a single sample queued to vary the indices */
+			verify(sample_ring_push(&r, &next_in));
+			next_in++;
+			verify(sample_ring_pop(&r, out));
+			verify(out[0] == next_out++);
+		}
+	}
+
+	verify(elemring_empty(&r));
+	verify(0 == sample_ring_pop_n(&r, out, lengthof(out)));
+}
+
+int main()
+{
+	test_records();
+	test_batch();
+
+	return 0;
+}
@@ -0,0 +1,517 @@
+/*
+ * fibresynctest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+typedef struct {
+	char id;
+	int runs;
+	fibre_t fibre;
+} sync_fibre_t;
+
+static char trace[64];
+static int tracep;
+
+static void record(char c)
+{
+	assert(tracep < (int) sizeof(trace) - 1);
+	trace[tracep++] = c;
+	trace[tracep] = '\0';
+}
+
+static void reset_trace(void)
+{
+	tracep = 0;
+	trace[0] = '\0';
+}
+
+static void run_until_idle(void)
+{
+	int i;
+
+	for (i=0; i<100; i++)
+		if (FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(0))
+			break;
+	verify(i < 100);
+}
+
+/* run everything due at time and return when the scheduler next wakes */
+static uint32_t run_until_sleep(uint32_t time)
+{
+	uint32_t next;
+	int i;
+
+	for (i=0; i<100; i++)
+		if (time != (next = fibre_scheduler_next(time)))
+			break;
+	verify(i < 100);
+	return next;
+}
+
+static fibre_mutex_t mutex = FIBRE_MUTEX_VAR_INIT;
+
+static int mutex_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	s->runs++;
+
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_mutex_lock(&mutex));
+	record(s->id);
+	PT_YIELD();
+	PT_YIELD();
+	record(s->id);
+	fibre_mutex_unlock(&mutex);
+
+	PT_END();
+}
+
+static void test_mutex()
+{
+	static sync_fibre_t sf[3] = {
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(mutex_fibre) },
+		{ .id = 'b', .fibre = FIBRE_VAR_INIT(mutex_fibre) },
+		{ .id = 'c', .fibre = FIBRE_VAR_INIT(mutex_fibre) }
+	};
+	fibre_mutex_t mymutex;
+
+	/* prove the equivalence of the initializer and the init fn */
+	fibre_mutex_init(&mymutex);
+	verify(0 == memcmp(&mutex, &mymutex, sizeof(mutex)));
+
+	reset_trace();
+	for (int i=0; i<lengthof(sf); i++)
+		fibre_run(&sf[i].fibre);
+	run_until_idle();
+
+	verify(0 == strcmp(trace, "aabbcc"));
+	verify(NULL == mutex.owner);
+
+	/* waiters run once to block and once when they get the mutex */
+	verify(3 == sf[0].runs);
+	verify(4 == sf[1].runs);
+	verify(4 == sf[2].runs);
+}
+
+static fibre_sem_t sem = FIBRE_SEM_VAR_INIT(1);
+
+static int sem_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	s->runs++;
+
+	PT_BEGIN_FIBRE(f);
+
+	while (true) {
+		PT_WAIT_UNTIL(fibre_sem_wait(&sem));
+		record(s->id);
+	}
+
+	PT_END();
+}
+
+static void test_sem()
+{
+	static sync_fibre_t sf[2] = {
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(sem_fibre) },
+		{ .id = 'b', .fibre = FIBRE_VAR_INIT(sem_fibre) }
+	};
+	fibre_sem_t mysem;
+
+	fibre_sem_init(&mysem, 1);
+	verify(0 == memcmp(&sem, &mysem, sizeof(sem)));
+
+	reset_trace();
+	for (int i=0; i<lengthof(sf); i++)
+		fibre_run(&sf[i].fibre);
+	run_until_idle();
+	verify(0 == strcmp(trace, "a"));
+
+	/* units are handed to waiters in FIFO order */
+	fibre_sem_post(&sem);
+	fibre_sem_post(&sem);
+	run_until_idle();
+	verify(0 == strcmp(trace, "aab"));
+	verify(0 == sem.count);
+
+	/* a spurious wake up does not release a waiter */
+	int runs = sf[0].runs;
+	fibre_run(&sf[0].fibre);
+	run_until_idle();
+	verify(runs + 1 == sf[0].runs);
+	verify(0 == strcmp(trace, "aab"));
+
+	/* once the waiters are released the count is incremented */
+	fibre_sem_post(&sem);
+	fibre_sem_post(&sem);
+	fibre_sem_post(&sem);
+	verify(1 == sem.count);
+	run_until_idle();
+	verify(0 == strcmp(trace, "aabaab"));
+	verify(0 == sem.count);
+}
+
+static fibre_mutex_t cond_mutex = FIBRE_MUTEX_VAR_INIT;
+static fibre_cond_t cond = FIBRE_COND_VAR_INIT;
+static int cond_ready;
+
+static int cond_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_mutex_lock(&cond_mutex));
+	while (!cond_ready)
+		PT_WAIT_UNTIL(fibre_cond_wait(&cond, &cond_mutex));
+	cond_ready--;
+	record(s->id);
+	PT_YIELD();
+	fibre_mutex_unlock(&cond_mutex);
+
+	PT_END();
+}
+
+static int signal_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_mutex_lock(&cond_mutex));
+	record(s->id);
+	cond_ready = 2;
+	fibre_cond_broadcast(&cond);
+	PT_YIELD();
+	fibre_mutex_unlock(&cond_mutex);
+
+	PT_END();
+}
+
+static void test_cond()
+{
+	static sync_fibre_t sf[3] = {
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(cond_fibre) },
+		{ .id = 'b', .fibre = FIBRE_VAR_INIT(cond_fibre) },
+		{ .id = 's', .fibre = FIBRE_VAR_INIT(signal_fibre) }
+	};
+	fibre_cond_t mycond;
+
+	fibre_cond_init(&mycond);
+	verify(0 == memcmp(&cond, &mycond, sizeof(cond)));
+
+	reset_trace();
+	fibre_run(&sf[0].fibre);
+	fibre_run(&sf[1].fibre);
+	run_until_idle();
+	verify(0 == strcmp(trace, ""));
+	verify(NULL == cond_mutex.owner);
+
+	/* the waiters cannot proceed until the signaller drops the mutex */
+	fibre_run(&sf[2].fibre);
+	run_until_idle();
+	verify(0 == strcmp(trace, "sab"));
+	verify(NULL == cond_mutex.owner && 0 == cond_ready);
+}
+
+static fibre_event_t event = FIBRE_EVENT_VAR_INIT;
+
+static int any_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	s->runs++;
+
+	PT_BEGIN_FIBRE(f);
+	PT_WAIT_UNTIL(fibre_event_wait_any(&event, 3));
+	record(s->id);
+	PT_END();
+}
+
+static int all_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	s->runs++;
+
+	PT_BEGIN_FIBRE(f);
+	PT_WAIT_UNTIL(fibre_event_wait_all(&event, 3));
+	record(s->id);
+	PT_END();
+}
+
+static void test_event()
+{
+	static sync_fibre_t sf[2] = {
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(any_fibre) },
+		{ .id = 'b', .fibre = FIBRE_VAR_INIT(all_fibre) }
+	};
+	fibre_event_t myevent;
+
+	fibre_event_init(&myevent);
+	verify(0 == memcmp(&event, &myevent, sizeof(event)));
+
+	reset_trace();
+	fibre_run(&sf[0].fibre);
+	fibre_run(&sf[1].fibre);
+	run_until_idle();
+	verify(0 == strcmp(trace, ""));
+
+	/* unrelated flags release the waiters but they block again */
+	fibre_event_set(&event, 4);
+	run_until_idle();
+	verify(0 == strcmp(trace, ""));
+	verify(2 == sf[0].runs && 2 == sf[1].runs);
+
+	fibre_event_set(&event, 1);
+	run_until_idle();
+	verify(0 == strcmp(trace, "a"));
+
+	fibre_event_set(&event, 2);
+	run_until_idle();
+	verify(0 == strcmp(trace, "ab"));
+
+	fibre_event_clear(&event, 3);
+	verify(4 == event.flags);
+}
+
+static fibre_cancel_t token = FIBRE_CANCEL_VAR_INIT;
+static fibre_sem_t cancel_sem = FIBRE_SEM_VAR_INIT(0);
+static fibre_mutex_t cancel_mutex = FIBRE_MUTEX_VAR_INIT;
+static bool holder_release;
+
+static int sem_cancel_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_cancelled() || fibre_sem_wait(&cancel_sem));
+	if (fibre_cancelled())
+		PT_EXIT();
+	record(s->id);
+
+	PT_END();
+}
+
+static int mutex_cancel_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_cancelled() || fibre_mutex_lock(&cancel_mutex));
+	if (fibre_cancelled())
+		PT_EXIT();
+	record(s->id);
+	fibre_mutex_unlock(&cancel_mutex);
+
+	PT_END();
+}
+
+static int holder_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_mutex_lock(&cancel_mutex));
+	record(s->id);
+	PT_WAIT_UNTIL(holder_release);
+
+	/* the first waiter is cancelled after ownership is handed to it */
+	fibre_mutex_unlock(&cancel_mutex);
+	fibre_cancel(&token);
+
+	PT_END();
+}
+
+static void test_cancel()
+{
+	static sync_fibre_t sf[2] = {
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(sem_cancel_fibre) },
+		{ .id = 'b', .fibre = FIBRE_VAR_INIT(sem_cancel_fibre) }
+	};
+	static sync_fibre_t mf[3] = {
+		{ .id = 'h', .fibre = FIBRE_VAR_INIT(holder_fibre) },
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(mutex_cancel_fibre) },
+		{ .id = 'b', .fibre = FIBRE_VAR_INIT(mutex_cancel_fibre) }
+	};
+
+	/* a unit posted to a fibre that is then cancelled is not lost */
+	reset_trace();
+	fibre_cancel_bind(&token, &sf[0].fibre);
+	fibre_run(&sf[0].fibre);
+	run_until_idle();
+	fibre_sem_post(&cancel_sem);
+	fibre_cancel(&token);
+	run_until_idle();
+	verify(0 == strcmp(trace, ""));
+	verify(1 == cancel_sem.count);
+
+	/* ... and if there is another waiter it is handed on */
+	fibre_sem_init(&cancel_sem, 0);
+	fibre_cancel_init(&token);
+	fibre_cancel_bind(&token, &sf[0].fibre);
+	fibre_run(&sf[0].fibre);
+	fibre_run(&sf[1].fibre);
+	run_until_idle();
+	fibre_sem_post(&cancel_sem);
+	fibre_cancel(&token);
+	run_until_idle();
+	verify(0 == strcmp(trace, "b"));
+	verify(0 == cancel_sem.count && dlist_empty(&cancel_sem.waiters));
+
+	/* killing a released waiter also returns the unit */
+	fibre_run(&sf[1].fibre);
+	run_until_idle();
+	fibre_sem_post(&cancel_sem);
+	verify(fibre_kill(&sf[1].fibre));
+	run_until_idle();
+	verify(0 == strcmp(trace, "b"));
+	verify(1 == cancel_sem.count);
+
+	/* a mutex handed to a cancelled fibre passes to the next waiter */
+	reset_trace();
+	fibre_cancel_init(&token);
+	fibre_cancel_bind(&token, &mf[1].fibre);
+	for (int i=0; i<lengthof(mf); i++)
+		fibre_run(&mf[i].fibre);
+	run_until_idle();
+	verify(&mf[0].fibre == cancel_mutex.owner);
+	holder_release = true;
+	fibre_run(&mf[0].fibre);
+	run_until_idle();
+	verify(0 == strcmp(trace, "hb"));
+	verify(NULL == cancel_mutex.owner);
+
+	/* ... and, with no other waiters, it is unlocked */
+	reset_trace();
+	holder_release = false;
+	fibre_cancel_init(&token);
+	fibre_cancel_bind(&token, &mf[1].fibre);
+	fibre_run(&mf[0].fibre);
+	fibre_run(&mf[1].fibre);
+	run_until_idle();
+	holder_release = true;
+	fibre_run(&mf[0].fibre);
+	run_until_idle();
+	verify(0 == strcmp(trace, "h"));
+	verify(NULL == cancel_mutex.owner);
+}
+
+static fibre_sem_t timeout_sem = FIBRE_SEM_VAR_INIT(0);
+static fibre_mutex_t timeout_mutex = FIBRE_MUTEX_VAR_INIT;
+static fibre_cond_t timeout_cond = FIBRE_COND_VAR_INIT;
+static bool timeout_release;
+
+static int timeout_holder_fibre(fibre_t *f)
+{
+	PT_BEGIN_FIBRE(f);
+
+	PT_WAIT_UNTIL(fibre_mutex_lock(&timeout_mutex));
+	PT_WAIT_UNTIL(timeout_release);
+	fibre_mutex_unlock(&timeout_mutex);
+
+	PT_END();
+}
+
+static int timeout_fibre(fibre_t *f)
+{
+	sync_fibre_t *s = containerof(f, sync_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	/* each wait times out and is abandoned by the next one */
+	PT_WAIT_UNTIL(fibre_sem_wait(&timeout_sem) || fibre_timeout(100));
+	record('s');
+	PT_WAIT_UNTIL(fibre_mutex_lock(&timeout_mutex) || fibre_timeout(200));
+	record('m');
+
+	/* the mutex is handed over whilst we are doing something else */
+	PT_WAIT_UNTIL(fibre_timeout(300));
+	record('t');
+
+	PT_WAIT_UNTIL(fibre_mutex_lock(&timeout_mutex));
+	PT_WAIT_UNTIL(fibre_cond_wait(&timeout_cond, &timeout_mutex) ||
+		      fibre_timeout(400));
+	verify(timeout_mutex.owner != f);
+	record('c');
+
+	PT_WAIT_UNTIL(fibre_sem_wait(&timeout_sem));
+	record(s->id);
+
+	PT_END();
+}
+
+static void test_timeout()
+{
+	static sync_fibre_t sf[2] = {
+		{ .id = 'h', .fibre = FIBRE_VAR_INIT(timeout_holder_fibre) },
+		{ .id = 'a', .fibre = FIBRE_VAR_INIT(timeout_fibre) }
+	};
+
+	reset_trace();
+	for (int i=0; i<lengthof(sf); i++)
+		fibre_run(&sf[i].fibre);
+	verify(100 == run_until_sleep(0));
+	verify(!dlist_empty(&timeout_sem.waiters));
+
+	/* the stale semaphore wait is withdrawn by the mutex wait */
+	verify(200 == run_until_sleep(100));
+	verify(0 == strcmp(trace, "s"));
+	verify(dlist_empty(&timeout_sem.waiters));
+	fibre_sem_post(&timeout_sem);
+	verify(1 == timeout_sem.count);
+
+	/* a mutex handed to a fibre that has given up on it is unlocked */
+	verify(300 == run_until_sleep(200));
+	verify(0 == strcmp(trace, "sm"));
+	timeout_release = true;
+	fibre_run(&sf[0].fibre);
+	verify(300 == run_until_sleep(200));
+	verify(NULL == timeout_mutex.owner);
+	verify(dlist_empty(&timeout_mutex.waiters));
+
+	/* a condition wait that times out does not disturb the next wait */
+	verify(400 == run_until_sleep(300));
+	verify(0 == strcmp(trace, "smt"));
+	verify(NULL == timeout_mutex.owner);
+	verify(!dlist_empty(&timeout_cond.waiters));
+	verify(400+FIBRE_UNBOUNDED_SLEEP == run_until_sleep(400));
+	verify(0 == strcmp(trace, "smtca"));
+	verify(0 == timeout_sem.count);
+	verify(dlist_empty(&timeout_cond.waiters));
+}
+
+int main()
+{
+	test_mutex();
+	test_sem();
+	test_cond();
+	test_event();
+	test_cancel();
+	test_timeout();
+
+	return 0;
+}
@@ -16,6 +16,14 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef CONFIG_FIBRE_SMP
+#include <pthread.h>
+#endif
+#ifdef CONFIG_FIBRE_WAIT_FD
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <librfn.h>
 
@@ -40,6 +48,21 @@ int sleep_fibre(fibre_t *f)
 	PT_END();
 }
 
+/* identical behaviour as a sleep_fibre but permits the wake up to slip */
+int slack_fibre(fibre_t *f)
+{
+	sleep_fibre_t *s = containerof(f, sleep_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	while (s->time < s->max_time) {
+		s->time += s->step;
+		PT_WAIT_UNTIL(fibre_timeout_slack(s->time, 50));
+	}
+
+	PT_END();
+}
+
 typedef struct {
 	uint32_t count;
 	uint32_t max_count;
@@ -346,11 +369,790 @@ static void yield_test()
 	       fibre_self() == NULL);
 }
 
+/*
+ * A test that many sleeping fibres wake in duetime order even when the
+ * timer wraps around.
+ */
+static void wrap_test()
+{
+	static sleep_fibre_t sleeper[16];
+	const uint32_t base = 0xffffff00;
+
+	/* launch the fibres in an order unrelated to their duetime */
+	for (int i=0; i<lengthof(sleeper); i++) {
+		int j = (i * 7) % lengthof(sleeper);
+		sleeper[j].time = base + 32 * j;
+		sleeper[j].max_time = sleeper[j].time + 1;
+		sleeper[j].step = 1;
+		fibre_init(&sleeper[j].fibre, sleep_fibre);
+		fibre_run(&sleeper[j].fibre);
+	}
+	for (int i=0; i<lengthof(sleeper)-1; i++)
+		verify(base == fibre_scheduler_next(base));
+	verify(base + 1 == fibre_scheduler_next(base));
+	verify(base + 1 == fibre_scheduler_next(base) && fibre_self() == NULL);
+
+	/* each fibre should now run to completion in the order of duetime */
+	for (int i=0; i<lengthof(sleeper); i++) {
+		uint32_t now = base + 32 * i + 1;
+		(void) fibre_scheduler_next(now);
+		verify(fibre_self() == &sleeper[i].fibre);
+	}
+	verify(fibre_scheduler_next(base + 1024) == base + 1024 +
+	       FIBRE_UNBOUNDED_SLEEP && fibre_self() == NULL);
+}
+
+/*
+ * A test that fibres can be killed (and restarted) regardless of which
+ * queue they are waiting on.
+ */
+static void kill_test()
+{
+	static sleep_fibre_t sleeper = {
+			.time = 100,
+			.max_time = 200,
+			.step = 10,
+			.fibre = FIBRE_VAR_INIT(sleep_fibre)
+	};
+
+	static yield_fibre_t yielder = {
+			.max_count = 100,
+			.fibre = FIBRE_VAR_INIT(yield_fibre)
+	};
+
+	/* kill fibres that are not running */
+	verify(!fibre_kill(&sleeper.fibre));
+	verify(!fibre_kill(&yielder.fibre));
+
+	/* kill a fibre on the run queue */
+	fibre_run(&sleeper.fibre);
+	fibre_run(&yielder.fibre);
+	verify(fibre_kill(&sleeper.fibre));
+	verify(!fibre_kill(&sleeper.fibre));
+	verify(100 == fibre_scheduler_next(100) && fibre_self() == &yielder.fibre);
+	verify(100 == sleeper.time && 1 == yielder.count);
+
+	/* kill a fibre on the timer queue (and then restart it) */
+	fibre_run(&sleeper.fibre);
+	verify(100 == fibre_scheduler_next(100) && fibre_self() == &sleeper.fibre);
+	verify(110 == sleeper.time && 1 == yielder.count);
+	verify(fibre_kill(&sleeper.fibre));
+	verify(!fibre_kill(&sleeper.fibre));
+	verify(120 == fibre_scheduler_next(120) && fibre_self() == &yielder.fibre);
+	verify(110 == sleeper.time && 2 == yielder.count);
+	fibre_run(&sleeper.fibre);
+	fibre_run(&sleeper.fibre); /* running twice must be harmless */
+	verify(fibre_kill(&yielder.fibre));
+	verify(130 == fibre_scheduler_next(120) && fibre_self() == &sleeper.fibre);
+	verify(130 == fibre_scheduler_next(120) && fibre_self() == NULL);
+	verify(130 == sleeper.time && 2 == yielder.count);
+
+	/* tidy up */
+	verify(fibre_kill(&sleeper.fibre));
+	verify(120+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(120));
+}
+
+/*
+ * A test that higher priority fibres always run first.
+ */
+static void priority_test()
+{
+	static yield_fibre_t yielder[3] = {
+		{
+			.max_count = 2,
+			.fibre = FIBRE_VAR_INIT(yield_fibre)
+		},
+		{
+			.max_count = 2,
+			.fibre = FIBRE_VAR_INIT(yield_fibre)
+		},
+		{
+			.max_count = 2,
+			.fibre = FIBRE_VAR_INIT(yield_fibre)
+		}
+	};
+	static sleep_fibre_t sleeper = {
+			.time = 200,
+			.max_time = 210,
+			.step = 10,
+			.fibre = FIBRE_VAR_INIT(sleep_fibre)
+	};
+
+	/* #1 and #2 share a (higher) priority and are scheduled round-robin */
+	fibre_set_priority(&yielder[1].fibre, 1);
+	fibre_run(&yielder[0].fibre);
+	fibre_run(&yielder[1].fibre);
+	fibre_run(&yielder[2].fibre);
+	fibre_set_priority(&yielder[2].fibre, 1); /* change whilst queued */
+	fibre_set_priority(&sleeper.fibre, CONFIG_FIBRE_PRIORITIES-1);
+	fibre_run(&sleeper.fibre);
+
+	verify(200 == fibre_scheduler_next(200) && fibre_self() == &sleeper.fibre);
+	verify(200 == fibre_scheduler_next(200) && fibre_self() == &yielder[1].fibre);
+	verify(200 == fibre_scheduler_next(200) && fibre_self() == &yielder[2].fibre);
+	verify(200 == fibre_scheduler_next(200) && fibre_self() == &yielder[1].fibre);
+
+	/* the sleeper pre-empts (at the next scheduling point) when it wakes */
+	verify(210 == fibre_scheduler_next(210) && fibre_self() == &sleeper.fibre);
+	verify(210 == fibre_scheduler_next(210) && fibre_self() == &yielder[2].fibre);
+	verify(210 == fibre_scheduler_next(210) && fibre_self() == &yielder[1].fibre);
+	verify(210 == fibre_scheduler_next(210) && fibre_self() == &yielder[2].fibre);
+
+	/* the low priority fibre runs only when nothing else is runnable */
+	verify(210 == fibre_scheduler_next(210) && fibre_self() == &yielder[0].fibre);
+	verify(210 == fibre_scheduler_next(210) && fibre_self() == &yielder[0].fibre);
+	verify(210+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(210) &&
+	       fibre_self() == &yielder[0].fibre);
+	verify(2 == yielder[0].count && 2 == yielder[1].count &&
+	       2 == yielder[2].count && 210 == sleeper.time);
+}
+
+/*
+ * A test that bursts of atomic wake ups are never lost.
+ */
+static void atomic_test()
+{
+	static yield_fibre_t waker[64];
+
+	for (int i=0; i<lengthof(waker); i++) {
+		waker[i].max_count = 1;
+		fibre_init(&waker[i].fibre, atomic_fibre);
+	}
+
+	/* far more wake ups than the old fixed size queue could hold */
+	for (int i=0; i<lengthof(waker); i++)
+		verify(fibre_run_atomic(&waker[i].fibre));
+
+	/* repeated wake ups are merged */
+	verify(fibre_run_atomic(&waker[0].fibre));
+
+	/* wake ups are delivered in order, each fibre re-queues itself once */
+	for (int i=0; i<lengthof(waker); i++)
+		verify(300 == fibre_scheduler_next(300) &&
+		       fibre_self() == &waker[i].fibre);
+	for (int i=0; i<lengthof(waker)-1; i++)
+		verify(300 == fibre_scheduler_next(300) &&
+		       fibre_self() == &waker[i].fibre);
+	verify(300+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(300) &&
+	       fibre_self() == &waker[lengthof(waker)-1].fibre);
+
+	for (int i=0; i<lengthof(waker); i++)
+		verify(1 == waker[i].count);
+}
+
+static void count_wakeup(void *ctx)
+{
+	(*(int *) ctx)++;
+}
+
+/*
+ * A test that a sleeping scheduler is woken by atomic wake ups.
+ */
+static void wakeup_test()
+{
+	static yield_fibre_t waker = {
+		.max_count = 0,
+		.fibre = FIBRE_VAR_INIT(yield_fibre)
+	};
+	int wakeups = 0;
+
+	fibre_scheduler_set_wakeup(count_wakeup, &wakeups);
+
+	/* no wake up is delivered unless the scheduler is sleeping */
+	verify(fibre_run_atomic(&waker.fibre));
+	verify(0 == wakeups);
+	verify(!fibre_scheduler_sleep_begin());
+	verify(400+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(400));
+
+	/* only one wake up is delivered for each sleep */
+	verify(fibre_scheduler_sleep_begin());
+	verify(fibre_run_atomic(&waker.fibre));
+	verify(1 == wakeups);
+	verify(fibre_run_atomic(&waker.fibre));
+	verify(1 == wakeups);
+	fibre_scheduler_sleep_end();
+	verify(400+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(400));
+	verify(&waker.fibre == fibre_self());
+
+	fibre_scheduler_set_wakeup(NULL, NULL);
+}
+
+#ifdef CONFIG_FIBRE_STATS
+/*
+ * A test of the fibre accounting (we can only check the counters because
+ * the run times are measured using the real clock).
+ */
+static void stats_test()
+{
+	static yield_fibre_t yielder = {
+		.max_count = 3,
+		.fibre = FIBRE_VAR_INIT(yield_fibre)
+	};
+	static fibre_stats_t stats = FIBRE_STATS_VAR_INIT("yielder");
+	fibre_kernel_stats_t before, after;
+
+	fibre_get_kernel_stats(&before);
+	fibre_set_stats(&yielder.fibre, &stats);
+	fibre_run(&yielder.fibre);
+
+	/* the fibre yields to itself so the last two passes are fast */
+	verify(500 == fibre_scheduler_next(500));
+	verify(500 == fibre_scheduler_next(500));
+	verify(500 == fibre_scheduler_next(500));
+	verify(500+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(500));
+	verify(4 == stats.runs);
+	verify(1 == stats.wakes);
+	verify(stats.max_run_time <= stats.total_run_time);
+
+	fibre_get_kernel_stats(&after);
+	verify(4 == after.passes - before.passes);
+	verify(3 == after.fast_path - before.fast_path);
+
+	FILE *out = fopen("/dev/null", "w");
+	verify(out);
+	fibre_stats_dump(out);
+	fclose(out);
+
+	fibre_set_stats(&yielder.fibre, NULL);
+}
+#endif
+
+static int busy_fibre(fibre_t *f)
+{
+	uint32_t start = time_now();
+
+	while (cyclecmp32(time_now(), start + 2000) < 0)
+		;
+
+	return PT_EXITED;
+}
+
+/*
+ * A test that the watchdog catches overruns and late timers.
+ */
+static void watchdog_test()
+{
+	static fibre_t busy = FIBRE_VAR_INIT(busy_fibre);
+	static sleep_fibre_t sleeper = {
+		.time = 600,
+		.max_time = 610,
+		.step = 10,
+		.fibre = FIBRE_VAR_INIT(sleep_fibre)
+	};
+	const uint32_t overrun = 1 << ('W' - 'A');
+	const uint32_t late = 1 << ('L' - 'A');
+	fibre_kernel_stats_t stats;
+
+	fibre_watchdog_set(1000, 100);
+
+	fibre_run(&sleeper.fibre);
+	verify(610 == fibre_scheduler_next(600));
+	fibre_get_kernel_stats(&stats);
+	verify(!(stats.taint_flags & (overrun | late)));
+
+	/* the timer is due at 610 so 710 is on time but 711 is late */
+	verify(710+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(710));
+	fibre_get_kernel_stats(&stats);
+	verify(!(stats.taint_flags & late));
+	sleeper.time = 720;
+	sleeper.max_time = 730;
+	fibre_run(&sleeper.fibre);
+	verify(730 == fibre_scheduler_next(720));
+	verify(831+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(831));
+	fibre_get_kernel_stats(&stats);
+	verify(stats.taint_flags & late);
+
+	fibre_run(&busy);
+	verify(900+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(900));
+	fibre_get_kernel_stats(&stats);
+	verify(stats.taint_flags & overrun);
+
+	fibre_watchdog_set(0, 0);
+}
+
+/*
+ * A test that timers with overlapping windows are released together.
+ */
+static void slack_test()
+{
+	static sleep_fibre_t sleeper[3] = {
+		{
+			.time = 1000,
+			.max_time = 1100,
+			.step = 100,
+			.fibre = FIBRE_VAR_INIT(slack_fibre)
+		},
+		{
+			.time = 1020,
+			.max_time = 1120,
+			.step = 100,
+			.fibre = FIBRE_VAR_INIT(slack_fibre)
+		},
+		{
+			.time = 1100,
+			.max_time = 1200,
+			.step = 100,
+			.fibre = FIBRE_VAR_INIT(sleep_fibre)
+		}
+	};
+
+	for (int i=0; i<lengthof(sleeper); i++)
+		fibre_run(&sleeper[i].fibre);
+	verify(1000 == fibre_scheduler_next(1000));
+	verify(1000 == fibre_scheduler_next(1000));
+
+	/* #0 is due at 1100 but can slip to 1150 */
+	verify(1150 == fibre_scheduler_next(1000));
+
+	/* #0 and #1 are released in the same pass but #2 is not yet due */
+	verify(1150 == fibre_scheduler_next(1150) &&
+	       fibre_self() == &sleeper[0].fibre);
+	verify(1200 == fibre_scheduler_next(1150) &&
+	       fibre_self() == &sleeper[1].fibre);
+	verify(1200+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(1200) &&
+	       fibre_self() == &sleeper[2].fibre);
+	for (int i=0; i<lengthof(sleeper); i++)
+		verify(sleeper[i].time == sleeper[i].max_time);
+}
+
+typedef struct {
+	int total;
+	int batches;
+	fibre_eventq_t evtq;
+} batch_eventq_t;
+
+static int batch_handler(fibre_t *f)
+{
+	fibre_eventq_t *fevtq = containerof(f, fibre_eventq_t, fibre);
+	batch_eventq_t *b = containerof(fevtq, batch_eventq_t, evtq);
+	event_descriptor_t *evt;
+	unsigned int n = 8;
+
+	while (NULL != (evt = fibre_eventq_receive_span(fevtq, &n))) {
+		for (unsigned int i=0; i<n; i++)
+			b->total += evt[i].id;
+		b->batches++;
+		fibre_eventq_release_span(fevtq, evt, n);
+		n = 8;
+	}
+
+	return PT_WAITING;
+}
+
+/*
+ * A test that events can be sent and received in batches.
+ */
+static void batch_test()
+{
+	static event_descriptor_t events[8];
+	static batch_eventq_t handler = {
+		.evtq = FIBRE_EVENTQ_VAR_INIT(batch_handler,
+				events, sizeof(events), sizeof(events[0]))
+	};
+	event_descriptor_t *evt;
+	unsigned int n = 6;
+
+	evt = fibre_eventq_claim_span(&handler.evtq, &n);
+	verify(evt && 6 == n);
+	for (unsigned int i=0; i<n; i++)
+		evt[i].id = i + 1;
+	verify(fibre_eventq_send_span(&handler.evtq, evt, n));
+
+	/* one pass handles the whole batch */
+	verify(1300+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(1300));
+	verify(21 == handler.total && 1 == handler.batches);
+
+	/* the next batch is split because it reaches the end of the buffer */
+	n = 4;
+	evt = fibre_eventq_claim_span(&handler.evtq, &n);
+	verify(evt && 2 == n);
+	for (unsigned int i=0; i<n; i++)
+		evt[i].id = 1;
+	verify(fibre_eventq_send_span(&handler.evtq, evt, n));
+	n = 2;
+	evt = fibre_eventq_claim_span(&handler.evtq, &n);
+	verify(evt == events && 2 == n);
+	for (unsigned int i=0; i<n; i++)
+		evt[i].id = 1;
+	verify(fibre_eventq_send_span(&handler.evtq, evt, n));
+	verify(1300+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(1300));
+	verify(25 == handler.total && 3 == handler.batches);
+}
+
+/* run fibres until they are all asleep, returning the next wake up time */
+static uint32_t run_until_idle(uint32_t time)
+{
+	uint32_t next;
+
+	while (time == (next = fibre_scheduler_next(time)))
+		;
+
+	return next;
+}
+
+typedef struct {
+	fibre_t *target;
+	int joined;
+	fibre_t fibre;
+} join_fibre_t;
+
+static int join_fibre(fibre_t *f)
+{
+	join_fibre_t *j = containerof(f, join_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+	PT_WAIT_UNTIL(fibre_join(j->target));
+	j->joined++;
+	PT_END();
+}
+
+static fibre_t *exited_fibre;
+static int exited_state;
+
+static void record_exit(fibre_t *f, int state)
+{
+	exited_fibre = f;
+	exited_state = state;
+}
+
+/*
+ * A test that fibres can wait for each other to exit.
+ */
+static void join_test()
+{
+	static yield_fibre_t yielder = {
+			.max_count = 3,
+			.fibre = FIBRE_VAR_INIT(yield_fibre)
+	};
+	static sleep_fibre_t sleeper = {
+			.time = 1400,
+			.max_time = 1500,
+			.step = 10,
+			.fibre = FIBRE_VAR_INIT(sleep_fibre)
+	};
+	static join_fibre_t joiners[2] = {
+		{ .target = &yielder.fibre, .fibre = FIBRE_VAR_INIT(join_fibre) },
+		{ .target = &yielder.fibre, .fibre = FIBRE_VAR_INIT(join_fibre) },
+	};
+
+	fibre_set_exit_handler(&yielder.fibre, record_exit);
+	fibre_set_exit_handler(&sleeper.fibre, record_exit);
+
+	/* both joiners are released when the yielder exits */
+	fibre_run(&yielder.fibre);
+	fibre_run(&joiners[0].fibre);
+	fibre_run(&joiners[1].fibre);
+	verify(1400+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1400));
+	verify(3 == yielder.count);
+	verify(1 == joiners[0].joined && 1 == joiners[1].joined);
+	verify(&yielder.fibre == exited_fibre);
+	verify(FIBRE_STATE_EXITED == exited_state);
+
+	/* joining a fibre that has already exited does not block */
+	fibre_run(&joiners[0].fibre);
+	verify(1400+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1400));
+	verify(2 == joiners[0].joined && 1 == joiners[1].joined);
+
+	/* killing a fibre also releases its joiners */
+	joiners[1].target = &sleeper.fibre;
+	fibre_run(&sleeper.fibre);
+	fibre_run(&joiners[1].fibre);
+	verify(1410 == run_until_idle(1400));
+	verify(1 == joiners[1].joined);
+	verify(fibre_kill(&sleeper.fibre));
+	verify(&sleeper.fibre == exited_fibre);
+	verify(FIBRE_STATE_WAITING == exited_state);
+	verify(1400+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1400));
+	verify(2 == joiners[1].joined);
+
+	/* joining a fibre that has already been killed does not block */
+	fibre_run(&joiners[1].fibre);
+	verify(1400+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1400));
+	verify(3 == joiners[1].joined);
+
+	/* ... until it is run again */
+	fibre_run(&sleeper.fibre);
+	fibre_run(&joiners[1].fibre);
+	verify(1410 == run_until_idle(1400));
+	verify(3 == joiners[1].joined);
+	verify(fibre_kill(&sleeper.fibre));
+	verify(1400+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1400));
+	verify(4 == joiners[1].joined);
+}
+
+typedef struct {
+	fibre_sem_t *sem;
+	uint32_t time;
+	int result;
+	int runs;
+	fibre_t fibre;
+} cancel_fibre_t;
+
+static int cancel_fibre(fibre_t *f)
+{
+	cancel_fibre_t *c = containerof(f, cancel_fibre_t, fibre);
+
+	c->runs++;
+
+	PT_BEGIN_FIBRE(f);
+
+	if (c->sem)
+		PT_WAIT_UNTIL(fibre_cancelled() || fibre_sem_wait(c->sem));
+	else
+		PT_WAIT_UNTIL(fibre_cancelled() || fibre_timeout(c->time));
+
+	c->result = fibre_cancelled() ? -1 : 1;
+
+	PT_END();
+}
+
+/*
+ * A test that a cancellation token wakes fibres from both timers and
+ * synchronization objects.
+ */
+static void cancel_test()
+{
+	static fibre_sem_t sem = FIBRE_SEM_VAR_INIT(0);
+	static fibre_cancel_t token = FIBRE_CANCEL_VAR_INIT;
+	static cancel_fibre_t fibres[3] = {
+		{ .sem = &sem, .fibre = FIBRE_VAR_INIT(cancel_fibre) },
+		{ .sem = &sem, .fibre = FIBRE_VAR_INIT(cancel_fibre) },
+		{ .time = 1600, .fibre = FIBRE_VAR_INIT(cancel_fibre) },
+	};
+	static cancel_fibre_t bystander = {
+		.sem = &sem, .fibre = FIBRE_VAR_INIT(cancel_fibre)
+	};
+
+	for (int i=0; i<lengthof(fibres); i++) {
+		fibre_cancel_bind(&token, &fibres[i].fibre);
+		fibre_run(&fibres[i].fibre);
+	}
+	fibre_run(&bystander.fibre);
+	verify(1600 == run_until_idle(1500));
+	for (int i=0; i<lengthof(fibres); i++)
+		verify(0 == fibres[i].result);
+
+	/* cancelled fibres are run at once and observe the cancellation */
+	fibre_cancel(&token);
+	verify(1500+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1500));
+	for (int i=0; i<lengthof(fibres); i++)
+		verify(-1 == fibres[i].result);
+	verify(0 == bystander.result);
+
+	/* the bystander is the only fibre left waiting on the semaphore */
+	fibre_sem_post(&sem);
+	verify(1500+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1500));
+	verify(1 == bystander.result && 0 == sem.count);
+
+	/* fibres that have exited are no longer bound to the token */
+	int runs[lengthof(fibres)];
+	for (int i=0; i<lengthof(fibres); i++)
+		runs[i] = fibres[i].runs;
+	verify(NULL == token.fibres);
+	fibre_cancel(&token);
+	verify(1500+FIBRE_UNBOUNDED_SLEEP == run_until_idle(1500));
+	for (int i=0; i<lengthof(fibres); i++)
+		verify(runs[i] == fibres[i].runs);
+}
+
+#ifdef CONFIG_FIBRE_WAIT_FD
+typedef struct {
+	int fd;
+	int wr;
+	uint32_t deadline;
+	bool ready;
+	int starts;
+	int exits;
+	fibre_t fibre;
+} fd_fibre_t;
+
+static fd_fibre_t fd_fibres[3];
+
+static int fd_fibre(fibre_t *f)
+{
+	fd_fibre_t *w = containerof(f, fd_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	w->starts++;
+	PT_WAIT_UNTIL((w->ready = fibre_wait_fd(w->fd, POLLIN)) ||
+		      (w->deadline && fibre_timeout(w->deadline)));
+	w->exits++;
+
+	PT_END();
+}
+
+static int fd_controller(fibre_t *f)
+{
+	static uint32_t t;
+	fd_fibre_t *w = fd_fibres;
+
+	PT_BEGIN_FIBRE(f);
+
+	/* a wait that times out leaves nothing registered */
+	t = time_now();
+	w[0].deadline = t + 10000;
+	fibre_run(&w[0].fibre);
+	PT_WAIT_UNTIL(fibre_timeout(t + 30000));
+	verify(1 == w[0].exits && !w[0].ready);
+	verify(0 == w[0].fibre.wait_fd);
+	verify(1 == write(w[0].wr, "x", 1));
+
+	/* nor does killing a fibre that is waiting */
+	fibre_run(&w[1].fibre);
+	PT_YIELD();
+	verify(1 == w[1].starts && w[1].fd + 1 == w[1].fibre.wait_fd);
+	verify(fibre_kill(&w[1].fibre));
+	verify(0 == w[1].fibre.wait_fd);
+	verify(1 == write(w[1].wr, "x", 1));
+
+	/* a descriptor becoming ready runs the fibre waiting for it */
+	fibre_run(&w[2].fibre);
+	PT_YIELD();
+	verify(1 == write(w[2].wr, "x", 1));
+
+	t = time_now();
+	PT_WAIT_UNTIL(fibre_timeout(t + 30000));
+	verify(1 == w[0].starts && 1 == w[0].exits);
+	verify(1 == w[1].starts && 0 == w[1].exits);
+	verify(1 == w[2].starts && 1 == w[2].exits && w[2].ready);
+	exit(0);
+
+	PT_END();
+}
+
+/*
+ * A test that descriptors are dropped by the scheduler once the fibre
+ * waiting for them has moved on. The scheduler main loop never returns
+ * so it is run in a child process.
+ */
+static void fd_test()
+{
+	static fibre_t controller = FIBRE_VAR_INIT(fd_controller);
+	int status;
+
+	pid_t pid = fork();
+	verify(pid >= 0);
+	if (0 == pid) {
+		alarm(10);
+		for (int i=0; i<lengthof(fd_fibres); i++) {
+			int p[2];
+
+			verify(0 == pipe(p));
+			fd_fibres[i].fd = p[0];
+			fd_fibres[i].wr = p[1];
+			fibre_init(&fd_fibres[i].fibre, fd_fibre);
+		}
+		fibre_run(&controller);
+		fibre_scheduler_main_loop();
+	}
+
+	verify(pid == waitpid(pid, &status, 0));
+	verify(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+}
+#endif
+
+#ifdef CONFIG_FIBRE_SMP
+typedef struct {
+	uint32_t count;
+	uint32_t max_count;
+	bool migrated;
+	fibre_t fibre;
+} smp_fibre_t;
+
+static pthread_t boot_thread;
+static atomic_uint smp_workers;
+static atomic_uint smp_finished;
+static atomic_bool smp_stop;
+
+static int smp_fibre(fibre_t *f)
+{
+	smp_fibre_t *s = containerof(f, smp_fibre_t, fibre);
+
+	PT_BEGIN_FIBRE(f);
+
+	while (s->count < s->max_count) {
+		s->count++;
+		if (!pthread_equal(pthread_self(), boot_thread))
+			s->migrated = true;
+		PT_YIELD();
+	}
+
+	atomic_fetch_add(&smp_finished, 1);
+	PT_END();
+}
+
+static void *smp_worker(void *unused)
+{
+	verify(fibre_scheduler_attach());
+	atomic_fetch_add(&smp_workers, 1);
+
+	while (!atomic_load(&smp_stop))
+		(void) fibre_scheduler_next(time_now());
+
+	return NULL;
+}
+
+/*
+ * A test that work started on one worker is shared with idle workers.
+ */
+static void smp_test()
+{
+	static smp_fibre_t fibres[16];
+	pthread_t workers[3];
+	bool migrated = false;
+
+	boot_thread = pthread_self();
+	for (int i=0; i<lengthof(workers); i++)
+		verify(0 == pthread_create(workers+i, NULL, smp_worker, NULL));
+	while (atomic_load(&smp_workers) != lengthof(workers))
+		;
+
+	for (int i=0; i<lengthof(fibres); i++) {
+		fibres[i].max_count = 100000;
+		fibre_init(&fibres[i].fibre, smp_fibre);
+		fibre_run(&fibres[i].fibre);
+	}
+
+	while (atomic_load(&smp_finished) != lengthof(fibres))
+		(void) fibre_scheduler_next(time_now());
+
+	atomic_store(&smp_stop, true);
+	for (int i=0; i<lengthof(workers); i++)
+		verify(0 == pthread_join(workers[i], NULL));
+
+	for (int i=0; i<lengthof(fibres); i++) {
+		verify(fibres[i].count == fibres[i].max_count);
+		migrated |= fibres[i].migrated;
+	}
+	verify(migrated);
+}
+#endif
+
 int main()
 {
 	basic_test();
 	sleep_test();
 	yield_test();
+	wrap_test();
+	kill_test();
+	priority_test();
+	atomic_test();
+	wakeup_test();
+#ifdef CONFIG_FIBRE_STATS
+	stats_test();
+#endif
+	watchdog_test();
+	slack_test();
+	batch_test();
+	join_test();
+	cancel_test();
+#ifdef CONFIG_FIBRE_WAIT_FD
+	fd_test();
+#endif
+#ifdef CONFIG_FIBRE_SMP
+	smp_test();
+#endif
 
 	return 0;
 }
@@ -0,0 +1,216 @@
+/*
+ * heaptest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+typedef struct {
+	uint32_t key;
+	heap_node_t node;
+} keyed_node_t;
+
+static int key_comparison(heap_node_t *n1, heap_node_t *n2)
+{
+	keyed_node_t *k1 = containerof(n1, keyed_node_t, node);
+	keyed_node_t *k2 = containerof(n2, keyed_node_t, node);
+
+	return cyclecmp32(k1->key, k2->key);
+}
+
+static keyed_node_t *extract(heap_t *heap)
+{
+	heap_node_t *node = heap_extract(heap);
+	return node ? containerof(node, keyed_node_t, node) : NULL;
+}
+
+static void test_heap_insert()
+{
+	heap_t heap = HEAP_VAR_INIT(key_comparison);
+	keyed_node_t n[3] = { { 0 } };
+	heap_t myheap;
+
+	/* prove the equivalence of the initializer and the init fn */
+	heap_init(&myheap, key_comparison);
+	verify(0 == memcmp(&heap, &myheap, sizeof(heap)));
+
+	verify(heap_empty(&heap));
+	verify(NULL == extract(&heap));
+
+	n[0].key = 1;
+	n[1].key = 2;
+	n[2].key = 3;
+
+	heap_insert(&heap, &n[0].node);
+	verify(!heap_empty(&heap));
+	verify(&n[0].node == heap_peek(&heap));
+	verify(n+0 == extract(&heap));
+	verify(NULL == extract(&heap));
+
+	/* insert in order */
+	heap_insert(&heap, &n[0].node);
+	heap_insert(&heap, &n[1].node);
+	heap_insert(&heap, &n[2].node);
+	verify(n+0 == extract(&heap));
+	verify(n+1 == extract(&heap));
+	verify(n+2 == extract(&heap));
+	verify(NULL == extract(&heap));
+
+	/* insert in reverse order */
+	heap_insert(&heap, &n[2].node);
+	heap_insert(&heap, &n[1].node);
+	heap_insert(&heap, &n[0].node);
+	verify(n+0 == extract(&heap));
+	verify(n+1 == extract(&heap));
+	verify(n+2 == extract(&heap));
+	verify(NULL == extract(&heap));
+
+	/* insert into the middle */
+	heap_insert(&heap, &n[2].node);
+	heap_insert(&heap, &n[0].node);
+	heap_insert(&heap, &n[1].node);
+	verify(n+0 == extract(&heap));
+	verify(n+1 == extract(&heap));
+	verify(n+2 == extract(&heap));
+	verify(NULL == extract(&heap));
+}
+
+static void test_heap_stable()
+{
+	heap_t heap = HEAP_VAR_INIT(key_comparison);
+	keyed_node_t n[64] = { { 0 } };
+
+	/* equal keys must be extracted in the order they were inserted */
+	for (int i=0; i<lengthof(n); i++) {
+		n[i].key = i % 4;
+		heap_insert(&heap, &n[i].node);
+	}
+
+	for (int k=0; k<4; k++)
+		for (int i=k; i<lengthof(n); i+=4)
+			verify(n+i == extract(&heap));
+	verify(NULL == extract(&heap));
+}
+
+static void test_heap_wrap()
+{
+	heap_t heap = HEAP_VAR_INIT(key_comparison);
+	keyed_node_t n[3] = { { 0 } };
+
+	/* the keys are cyclic so 0 comes *after* 0xffffffff */
+	n[0].key = 0xfffffff0;
+	n[1].key = 0xffffffff;
+	n[2].key = 0x00000010;
+
+	heap_insert(&heap, &n[2].node);
+	heap_insert(&heap, &n[1].node);
+	heap_insert(&heap, &n[0].node);
+	verify(n+0 == extract(&heap));
+	verify(n+1 == extract(&heap));
+	verify(n+2 == extract(&heap));
+	verify(NULL == extract(&heap));
+}
+
+static void test_heap_remove()
+{
+	heap_t heap = HEAP_VAR_INIT(key_comparison);
+	keyed_node_t n[4] = { { 0 } };
+
+	for (int i=0; i<lengthof(n); i++)
+		n[i].key = i;
+
+	verify(false == heap_remove(&heap, &n[0].node));
+
+	/* remove the root */
+	heap_insert(&heap, &n[0].node);
+	verify(heap_contains(&heap, &n[0].node));
+	verify(true == heap_remove(&heap, &n[0].node));
+	verify(false == heap_contains(&heap, &n[0].node));
+	verify(false == heap_remove(&heap, &n[0].node));
+	verify(heap_empty(&heap));
+
+	/* remove from the middle */
+	for (int i=0; i<lengthof(n); i++)
+		heap_insert(&heap, &n[i].node);
+	verify(true == heap_remove(&heap, &n[2].node));
+	verify(false == heap_remove(&heap, &n[2].node));
+	verify(n+0 == extract(&heap));
+	verify(n+1 == extract(&heap));
+	verify(n+3 == extract(&heap));
+	verify(NULL == extract(&heap));
+
+	/* remove a node with children */
+	for (int i=lengthof(n)-1; i>=0; i--)
+		heap_insert(&heap, &n[i].node);
+	verify(n+0 == extract(&heap));
+	verify(true == heap_remove(&heap, &n[1].node));
+	verify(n+2 == extract(&heap));
+	verify(n+3 == extract(&heap));
+	verify(NULL == extract(&heap));
+}
+
+/* compare against a trivial reference implementation */
+static void test_heap_soak()
+{
+	heap_t heap = HEAP_VAR_INIT(key_comparison);
+	static keyed_node_t n[256];
+	bool present[lengthof(n)] = { 0 };
+	uint32_t seed = RAND31_VAR_INIT;
+
+	for (int i=0; i<100000; i++) {
+		uint32_t r = rand31_r(&seed);
+		keyed_node_t *p = n + (r % lengthof(n));
+		int idx = p - n;
+
+		switch ((r >> 8) % 3) {
+		case 0:
+			if (!present[idx]) {
+				p->key = rand31_r(&seed) & 0xffff;
+				heap_insert(&heap, &p->node);
+				present[idx] = true;
+			}
+			break;
+		case 1:
+			verify(present[idx] == heap_remove(&heap, &p->node));
+			present[idx] = false;
+			break;
+		case 2: {
+			keyed_node_t *min = NULL;
+			for (int j=0; j<lengthof(n); j++)
+				if (present[j] && (!min || n[j].key < min->key))
+					min = n + j;
+			p = extract(&heap);
+			verify(p == min || (p && p->key == min->key));
+			if (p)
+				present[p - n] = false;
+			break;
+		}
+		}
+	}
+}
+
+int main()
+{
+	test_heap_insert();
+	test_heap_stable();
+	test_heap_wrap();
+	test_heap_remove();
+	test_heap_soak();
+
+	return 0;
+}
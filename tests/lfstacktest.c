@@ -0,0 +1,142 @@
+/*
+ * lfstacktest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <librfn.h>
+
+static void test_basic()
+{
+	lfstack_t s = LFSTACK_VAR_INIT;
+	list_node_t n[3] = { LIST_NODE_VAR_INIT };
+	list_node_t *chain;
+
+	verify(lfstack_empty(&s));
+	verify(NULL == lfstack_pop(&s));
+	verify(NULL == lfstack_pop_all(&s));
+
+	for (int i=0; i<lengthof(n); i++)
+		lfstack_push(&s, &n[i]);
+	verify(!lfstack_empty(&s));
+
+	/* last in, first out */
+	verify(&n[2] == lfstack_pop(&s));
+	verify(NULL == n[2].next);
+	lfstack_push(&s, &n[2]);
+	verify(&n[2] == lfstack_pop(&s));
+	verify(&n[1] == lfstack_pop(&s));
+	verify(&n[0] == lfstack_pop(&s));
+	verify(lfstack_empty(&s));
+
+	/* pop_all returns the nodes as a chain */
+	for (int i=0; i<lengthof(n); i++)
+		lfstack_push(&s, &n[i]);
+	chain = lfstack_pop_all(&s);
+	verify(lfstack_empty(&s));
+	verify(chain == &n[2] && n[2].next == &n[1] && n[1].next == &n[0] &&
+	       n[0].next == NULL);
+}
+
+#ifdef HAVE_PTHREAD_H
+#define NUM_THREADS 4
+#define NUM_NODES 16
+#define NUM_LOOPS 100000
+
+typedef struct {
+	list_node_t node;
+	unsigned int owner;
+	atomic_uint uses;
+} stress_node_t;
+
+static stress_node_t stress_nodes[NUM_THREADS * NUM_NODES];
+static lfstack_t stress_stack = LFSTACK_VAR_INIT;
+
+/* repeatedly pop and push nodes from a shared free list */
+static void *churn(void *arg)
+{
+	for (int i=0; i<NUM_LOOPS; i++) {
+		list_node_t *node = lfstack_pop(&stress_stack);
+		if (node) {
+			stress_node_t *n = containerof(node, stress_node_t, node);
+
+			/* no other thread holds this node */
+			verify(0 == atomic_fetch_add(&n->uses, 1));
+			atomic_fetch_sub(&n->uses, 1);
+			lfstack_push(&stress_stack, node);
+		}
+	}
+
+	return arg;
+}
+
+/* push our nodes from several threads at once */
+static void *populate(void *arg)
+{
+	unsigned int owner = (uintptr_t) arg;
+
+	for (int i=0; i<NUM_NODES; i++) {
+		stress_node_t *n = &stress_nodes[owner * NUM_NODES + i];
+		n->owner = owner;
+		lfstack_push(&stress_stack, &n->node);
+	}
+
+	return arg;
+}
+
+static void test_threads()
+{
+	pthread_t threads[NUM_THREADS];
+	/* without ABA protection pops must not run concurrently */
+	int churners = LFSTACK_ABA_SAFE ? NUM_THREADS : 1;
+	list_node_t *node;
+	int count = 0;
+
+	for (uintptr_t i=0; i<NUM_THREADS; i++)
+		verify(0 == pthread_create(&threads[i], NULL, populate,
+					   (void *) i));
+	for (int i=0; i<NUM_THREADS; i++)
+		verify(0 == pthread_join(threads[i], NULL));
+
+	for (int i=0; i<churners; i++)
+		verify(0 == pthread_create(&threads[i], NULL, churn, NULL));
+	for (int i=0; i<churners; i++)
+		verify(0 == pthread_join(threads[i], NULL));
+
+	/* every node is still on the stack exactly once */
+	for (node = lfstack_pop_all(&stress_stack); node; node = node->next) {
+		stress_node_t *n = containerof(node, stress_node_t, node);
+		verify(n->owner < NUM_THREADS);
+		n->owner = NUM_THREADS;
+		count++;
+	}
+	verify(count == lengthof(stress_nodes));
+}
+#endif
+
+int main()
+{
+	test_basic();
+#ifdef HAVE_PTHREAD_H
+	test_threads();
+#endif
+
+	return 0;
+}
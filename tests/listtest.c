@@ -393,6 +393,143 @@ static void test_list_remove()
 	// no dynamic allocation so no need to clean up
 }
 
+typedef struct {
+	int key;
+	list_node_t node;
+} keyed_node_t;
+
+static int key_comparison(list_node_t *n1, list_node_t *n2)
+{
+	return containerof(n1, keyed_node_t, node)->key -
+	       containerof(n2, keyed_node_t, node)->key;
+}
+
+/* check the list contents (and its tail pointer) against the nodes array */
+static bool check_list(list_t *list, list_node_t **expected, int n)
+{
+	list_iterator_t iter;
+	list_node_t *curr = list_iterate(list, &iter);
+
+	for (int i=0; i<n; i++) {
+		if (curr != expected[i])
+			return false;
+		curr = list_iterator_next(&iter);
+	}
+
+	return !curr && (!n || list->tail == expected[n-1]);
+}
+
+static void test_list_splice_split()
+{
+	list_t a = LIST_VAR_INIT, b = LIST_VAR_INIT;
+	list_node_t n[4] = { LIST_NODE_VAR_INIT };
+
+	/* splice empty lists */
+	list_splice(&a, &b);
+	verify(list_empty(&a) && list_empty(&b));
+
+	/* splice into empty list, then onto a non-empty one */
+	list_insert(&b, &n[0]);
+	list_insert(&b, &n[1]);
+	list_splice(&a, &b);
+	verify(list_empty(&b));
+	list_insert(&b, &n[2]);
+	list_insert(&b, &n[3]);
+	list_splice(&a, &b);
+	verify(list_empty(&b));
+	verify(check_list(&a,
+			  (list_node_t *[]) { &n[0], &n[1], &n[2], &n[3] }, 4));
+
+	/* split in the middle and at the tail */
+	list_split(&a, &n[1], &b);
+	verify(check_list(&a, (list_node_t *[]) { &n[0], &n[1] }, 2));
+	verify(check_list(&b, (list_node_t *[]) { &n[2], &n[3] }, 2));
+	list_t c = LIST_VAR_INIT;
+	list_split(&b, &n[3], &c);
+	verify(check_list(&b, (list_node_t *[]) { &n[2], &n[3] }, 2));
+	verify(list_empty(&c));
+
+	/* split at the head */
+	list_split(&b, NULL, &c);
+	verify(list_empty(&b));
+	verify(check_list(&c, (list_node_t *[]) { &n[2], &n[3] }, 2));
+
+	/* the lists remain usable */
+	list_insert(&a, list_extract(&c));
+	verify(check_list(&a, (list_node_t *[]) { &n[0], &n[1], &n[2] }, 3));
+}
+
+static void test_list_merge_sorted()
+{
+	list_t a = LIST_VAR_INIT, b = LIST_VAR_INIT;
+	keyed_node_t n[6] = { { 0 } };
+	const int keys[] = { 1, 3, 3, 2, 3, 4 };
+
+	for (int i=0; i<lengthof(n); i++) {
+		n[i].key = keys[i];
+		list_insert(i < 3 ? &a : &b, &n[i].node);
+	}
+
+	/* equal keys from the first list come first */
+	list_merge_sorted(&a, &b, key_comparison);
+	verify(list_empty(&b));
+	verify(check_list(&a, (list_node_t *[]) { &n[0].node, &n[3].node,
+				&n[1].node, &n[2].node, &n[4].node,
+				&n[5].node }, 6));
+
+	/* merging with empty lists */
+	list_merge_sorted(&a, &b, key_comparison);
+	verify(&n[5].node == a.tail);
+	list_merge_sorted(&b, &a, key_comparison);
+	verify(list_empty(&a) && &n[5].node == b.tail);
+}
+
+static void test_list_sort()
+{
+	static keyed_node_t n[1000], ref[lengthof(n)];
+	list_t list = LIST_VAR_INIT;
+	list_t reflist = LIST_VAR_INIT;
+	uint32_t seed = RAND31_VAR_INIT;
+
+	/* empty and single node lists */
+	list_sort(&list, key_comparison);
+	verify(list_empty(&list));
+	list_insert(&list, &n[0].node);
+	list_sort(&list, key_comparison);
+	verify(check_list(&list, (list_node_t *[]) { &n[0].node }, 1));
+	verify(&n[0].node == list_extract(&list));
+
+	for (int len=2; len<=lengthof(n); len = len*3 + 1) {
+		/* use few distinct keys so the sort must be stable to pass */
+		for (int i=0; i<len; i++) {
+			n[i].key = ref[i].key = rand31_r(&seed) % 16;
+			list_insert(&list, &n[i].node);
+		}
+
+		/* list_insert_sorted() is stable so provides a reference */
+		for (int i=0; i<len; i++)
+			list_insert_sorted(&reflist, &ref[i].node,
+					   key_comparison);
+
+		list_sort(&list, key_comparison);
+
+		list_node_t *curr = list_peek(&list);
+		list_node_t *tail = NULL;
+		for (int i=0; i<len; i++) {
+			keyed_node_t *r =
+			    containerof(list_extract(&reflist), keyed_node_t, node);
+			verify(curr == &n[r - ref].node);
+			tail = curr;
+			curr = curr->next;
+		}
+		verify(!curr && list.tail == tail);
+		verify(list_empty(&reflist));
+
+		while (list_extract(&list))
+			;
+	}
+}
+
 int main()
 {
 	test_list_insert();
@@ -402,6 +539,9 @@ int main()
 	test_list_iterator_insert_remove();
 	test_list_contains();
 	test_list_remove();
+	test_list_splice_split();
+	test_list_merge_sorted();
+	test_list_sort();
 
 	return 0;
 }
@@ -18,6 +18,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef CONFIG_MESSAGEQ_WAIT
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #include <librfn.h>
 
 int queue_buf[3];
@@ -25,6 +30,126 @@ messageq_t queue = MESSAGEQ_VAR_INIT(
 		queue_buf, sizeof(queue_buf), sizeof(queue_buf[0]));
 
 
+static void test_span()
+{
+	static int buf[8];
+	messageq_t mq = MESSAGEQ_VAR_INIT(buf, sizeof(buf), sizeof(buf[0]));
+	unsigned int n;
+	int *p;
+
+	/* claim more than available */
+	n = 5;
+	verify(buf+0 == messageq_claim_span(&mq, &n) && 5 == n);
+	n = 5;
+	verify(buf+5 == messageq_claim_span(&mq, &n) && 3 == n);
+	n = 1;
+	verify(NULL == messageq_claim_span(&mq, &n) && 0 == n);
+	verify(NULL == messageq_claim(&mq));
+
+	/* only the contiguous prefix of sent messages can be received */
+	messageq_send_span(&mq, buf+0, 3);
+	messageq_send_span(&mq, buf+5, 3);
+	n = 8;
+	verify(buf+0 == messageq_receive_span(&mq, &n) && 3 == n);
+	messageq_release_span(&mq, buf+0, n);
+	n = 8;
+	verify(NULL == messageq_receive_span(&mq, &n) && 0 == n);
+	messageq_send_span(&mq, buf+3, 2);
+	n = 8;
+	verify(buf+3 == messageq_receive_span(&mq, &n) && 5 == n);
+	messageq_release_span(&mq, buf+3, n);
+	verify(messageq_empty(&mq));
+
+	/* spans never wrap around the end of the buffer */
+	n = 8;
+	verify(buf+0 == messageq_claim_span(&mq, &n) && 8 == n);
+	messageq_send_span(&mq, buf, 8);
+	n = 2;
+	verify(buf+0 == messageq_receive_span(&mq, &n) && 2 == n);
+	messageq_release_span(&mq, buf, 2);
+	n = 8;
+	verify(buf+0 == messageq_claim_span(&mq, &n) && 2 == n);
+	messageq_send_span(&mq, buf, 2);
+	n = 8;
+	verify(buf+2 == messageq_receive_span(&mq, &n) && 6 == n);
+	messageq_release_span(&mq, buf+2, 6);
+	verify(buf+0 == (p = messageq_receive(&mq)));
+	messageq_release(&mq, p);
+	n = 8;
+	verify(buf+1 == messageq_receive_span(&mq, &n) && 1 == n);
+	messageq_release_span(&mq, buf+1, 1);
+	verify(messageq_empty(&mq));
+}
+
+#ifdef CONFIG_MESSAGEQ_WAIT
+static int wait_buf[2];
+static messageq_t wait_queue = MESSAGEQ_VAR_INIT(
+		wait_buf, sizeof(wait_buf), sizeof(wait_buf[0]));
+
+static void *wait_sender(void *arg)
+{
+	for (int i=0; i<1000; i++) {
+		int *p = messageq_claim_wait(&wait_queue, MESSAGEQ_WAIT_FOREVER);
+		verify(p);
+		*p = i;
+		messageq_send(&wait_queue, p);
+	}
+
+	return arg;
+}
+
+static void *late_sender(void *arg)
+{
+	usleep(20000);
+	int *p = messageq_claim(&wait_queue);
+	verify(p);
+	*p = 1000;
+	messageq_send(&wait_queue, p);
+
+	return arg;
+}
+
+static void test_wait()
+{
+	pthread_t thread;
+	uint32_t start;
+
+	/* timeouts */
+	start = time_now();
+	verify(NULL == messageq_receive_wait(&wait_queue, 0));
+	verify(NULL == messageq_receive_wait(&wait_queue, 20000));
+	verify(cyclecmp32(time_now(), start + 20000) >= 0);
+	verify(0 == atomic_load(&wait_queue.waiters));
+
+	verify(messageq_claim_wait(&wait_queue, 0));
+	verify(messageq_claim_wait(&wait_queue, 0));
+	verify(NULL == messageq_claim_wait(&wait_queue, 1000));
+	messageq_send(&wait_queue, wait_buf+0);
+	messageq_send(&wait_queue, wait_buf+1);
+	verify(wait_buf+0 == messageq_receive_wait(&wait_queue, 0));
+	messageq_release(&wait_queue, wait_buf+0);
+	verify(wait_buf+1 == messageq_receive_wait(&wait_queue, 0));
+	messageq_release(&wait_queue, wait_buf+1);
+
+	/* a small queue forces both sides to block */
+	verify(0 == pthread_create(&thread, NULL, wait_sender, NULL));
+	for (int i=0; i<1000; i++) {
+		int *p = messageq_receive_wait(&wait_queue, MESSAGEQ_WAIT_FOREVER);
+		verify(p && *p == i);
+		messageq_release(&wait_queue, p);
+	}
+	verify(0 == pthread_join(thread, NULL));
+	verify(0 == atomic_load(&wait_queue.waiters));
+
+	/* timeouts longer than 2^31 us must not expire at once */
+	verify(0 == pthread_create(&thread, NULL, late_sender, NULL));
+	int *p = messageq_receive_wait(&wait_queue, 0x80000000);
+	verify(p && *p == 1000);
+	messageq_release(&wait_queue, p);
+	verify(0 == pthread_join(thread, NULL));
+}
+#endif
+
 int main()
 {
 	messageq_t myqueue;
@@ -128,5 +253,10 @@ int main()
         messageq_release(&queue, queue_buf+2);
 	verify(true == messageq_empty(&queue));
 
+	test_span();
+#ifdef CONFIG_MESSAGEQ_WAIT
+	test_wait();
+#endif
+
 	return 0;
 }
@@ -0,0 +1,199 @@
+/*
+ * mpmcqtest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <librfn.h>
+
+static void test_basic()
+{
+	static int buf[64];
+	static atomic_uint seq[64];
+	mpmcq_t q = MPMCQ_VAR_INIT(buf, seq, sizeof(buf), sizeof(buf[0]));
+	mpmcq_t myq;
+	int *p;
+
+	/* prove the equivalence of the initializer and the init fn */
+	mpmcq_init(&myq, buf, seq, sizeof(buf), sizeof(buf[0]));
+	verify(q.basep == myq.basep && q.seqp == myq.seqp);
+	verify(q.msg_len == myq.msg_len && q.mask == myq.mask);
+	verify(atomic_load(&q.sendp) == atomic_load(&myq.sendp));
+	verify(atomic_load(&q.receivep) == atomic_load(&myq.receivep));
+
+	/* the indices must not share a cache line */
+	verify(offsetof(mpmcq_t, receivep) - offsetof(mpmcq_t, sendp) >=
+	       CONFIG_CACHE_LINE_SIZE);
+
+	verify(NULL == mpmcq_receive(&q));
+
+	/* fill the queue (which is deeper than a messageq can be) */
+	for (int i=0; i<lengthof(buf); i++) {
+		p = mpmcq_claim(&q);
+		verify(p == buf+i);
+		*p = i;
+		mpmcq_send(&q, p);
+	}
+	verify(NULL == mpmcq_claim(&q));
+
+	for (int i=0; i<lengthof(buf); i++) {
+		p = mpmcq_receive(&q);
+		verify(p == buf+i && *p == i);
+		mpmcq_release(&q, p);
+	}
+	verify(NULL == mpmcq_receive(&q));
+
+	/* claimed but unsent messages block the receiver */
+	int *a = mpmcq_claim(&q);
+	int *b = mpmcq_claim(&q);
+	verify(a == buf+0 && b == buf+1);
+	mpmcq_send(&q, b);
+	verify(NULL == mpmcq_receive(&q));
+	mpmcq_send(&q, a);
+	verify(a == mpmcq_receive(&q));
+	verify(b == mpmcq_receive(&q));
+	verify(NULL == mpmcq_receive(&q));
+
+	/* unreleased messages block the sender one lap later */
+	mpmcq_release(&q, b);
+	for (int i=2; i<lengthof(buf); i++)
+		mpmcq_send(&q, mpmcq_claim(&q));
+	verify(NULL == mpmcq_claim(&q));
+	mpmcq_release(&q, a);
+	verify(a == mpmcq_claim(&q));
+	verify(b == mpmcq_claim(&q));
+	verify(NULL == mpmcq_claim(&q));
+}
+
+static void test_wrap()
+{
+	static int buf[4];
+	static atomic_uint seq[4];
+	mpmcq_t q = MPMCQ_VAR_INIT(buf, seq, sizeof(buf), sizeof(buf[0]));
+	int *p;
+
+	/* run many laps with the queue partially full */
+	for (int i=0; i<1000; i++) {
+		p = mpmcq_claim(&q);
+		*p = i;
+		mpmcq_send(&q, p);
+		if (i >= 2) {
+			p = mpmcq_receive(&q);
+			verify(p && *p == i - 2);
+			mpmcq_release(&q, p);
+		}
+	}
+
+	/* ... and then with the indices close to overflow (the sequence
+	 * numbers are relative to the slot index)
+	 */
+	mpmcq_init(&q, buf, seq, sizeof(buf), sizeof(buf[0]));
+	atomic_store(&q.sendp, 0xfffffffe);
+	atomic_store(&q.receivep, 0xfffffffe);
+	for (int i=0; i<lengthof(seq); i++)
+		atomic_store(&seq[i], i < 2 ? 0 : 0xfffffffc);
+	for (int i=0; i<16; i++) {
+		p = mpmcq_claim(&q);
+		verify(p);
+		*p = i;
+		mpmcq_send(&q, p);
+		p = mpmcq_receive(&q);
+		verify(p && *p == i);
+		mpmcq_release(&q, p);
+	}
+}
+
+#ifdef HAVE_PTHREAD_H
+#define NUM_THREADS 4
+#define NUM_MSGS 100000
+
+static int stress_buf[128];
+static atomic_uint stress_seq[128];
+static mpmcq_t stress_q = MPMCQ_VAR_INIT(
+		stress_buf, stress_seq, sizeof(stress_buf),
+		sizeof(stress_buf[0]));
+static atomic_uint stress_received;
+static uint64_t stress_total[NUM_THREADS];
+
+static void *producer(void *arg)
+{
+	for (int i=1; i<=NUM_MSGS; i++) {
+		int *p;
+
+		while (NULL == (p = mpmcq_claim(&stress_q)))
+			;
+		*p = i;
+		mpmcq_send(&stress_q, p);
+	}
+
+	return arg;
+}
+
+static void *consumer(void *arg)
+{
+	uint64_t *total = arg;
+
+	while (atomic_load(&stress_received) < NUM_THREADS * NUM_MSGS) {
+		int *p = mpmcq_receive(&stress_q);
+		if (p) {
+			*total += *p;
+			mpmcq_release(&stress_q, p);
+			atomic_fetch_add(&stress_received, 1);
+		}
+	}
+
+	return NULL;
+}
+
+static void test_threads()
+{
+	pthread_t producers[NUM_THREADS], consumers[NUM_THREADS];
+	uint64_t total = 0;
+
+	for (int i=0; i<NUM_THREADS; i++) {
+		verify(0 == pthread_create(&consumers[i], NULL, consumer,
+					   &stress_total[i]));
+		verify(0 == pthread_create(&producers[i], NULL, producer,
+					   NULL));
+	}
+
+	for (int i=0; i<NUM_THREADS; i++) {
+		verify(0 == pthread_join(producers[i], NULL));
+		verify(0 == pthread_join(consumers[i], NULL));
+		total += stress_total[i];
+	}
+
+	/* every message was received exactly once */
+	verify(total == (uint64_t) NUM_THREADS * NUM_MSGS * (NUM_MSGS + 1) / 2);
+	verify(NULL == mpmcq_receive(&stress_q));
+}
+#endif
+
+int main()
+{
+	test_basic();
+	test_wrap();
+#ifdef HAVE_PTHREAD_H
+	test_threads();
+#endif
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * mpscqtest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <librfn.h>
+
+static void test_basic()
+{
+	mpscq_t q = MPSCQ_VAR_INIT;
+	list_node_t n[3] = { LIST_NODE_VAR_INIT };
+
+	verify(mpscq_empty(&q));
+	verify(NULL == mpscq_extract(&q));
+
+	/* a single node (which requires the stub to be requeued) */
+	mpscq_insert(&q, &n[0]);
+	verify(!mpscq_empty(&q));
+	verify(&n[0] == mpscq_extract(&q));
+	verify(NULL == n[0].next);
+	verify(mpscq_empty(&q));
+	verify(NULL == mpscq_extract(&q));
+
+	/* first in, first out, with insertions interleaved */
+	for (int loop=0; loop<3; loop++) {
+		mpscq_insert(&q, &n[0]);
+		mpscq_insert(&q, &n[1]);
+		verify(&n[0] == mpscq_extract(&q));
+		mpscq_insert(&q, &n[2]);
+		verify(&n[1] == mpscq_extract(&q));
+		verify(!mpscq_empty(&q));
+		verify(&n[2] == mpscq_extract(&q));
+		verify(mpscq_empty(&q));
+		verify(NULL == mpscq_extract(&q));
+	}
+}
+
+#ifdef HAVE_PTHREAD_H
+#define NUM_THREADS 4
+#define NUM_MSGS 100000
+
+typedef struct {
+	list_node_t node;
+	unsigned int producer;
+	unsigned int seq;
+} stress_msg_t;
+
+static stress_msg_t stress_msgs[NUM_THREADS][NUM_MSGS];
+static mpscq_t stress_q = MPSCQ_VAR_INIT;
+
+static void *producer(void *arg)
+{
+	unsigned int id = (uintptr_t) arg;
+
+	for (int i=0; i<NUM_MSGS; i++) {
+		stress_msgs[id][i].producer = id;
+		stress_msgs[id][i].seq = i;
+		mpscq_insert(&stress_q, &stress_msgs[id][i].node);
+	}
+
+	return arg;
+}
+
+static void test_threads()
+{
+	pthread_t producers[NUM_THREADS];
+	unsigned int next_seq[NUM_THREADS] = { 0 };
+
+	for (uintptr_t i=0; i<NUM_THREADS; i++)
+		verify(0 == pthread_create(&producers[i], NULL, producer,
+					   (void *) i));
+
+	/* messages from each producer must arrive in order */
+	for (int received=0; received < NUM_THREADS * NUM_MSGS; ) {
+		list_node_t *node = mpscq_extract(&stress_q);
+		if (!node) {
+			sched_yield();
+			continue;
+		}
+
+		stress_msg_t *msg = containerof(node, stress_msg_t, node);
+		verify(msg->producer < NUM_THREADS);
+		verify(msg->seq == next_seq[msg->producer]++);
+		received++;
+	}
+
+	for (int i=0; i<NUM_THREADS; i++)
+		verify(0 == pthread_join(producers[i], NULL));
+
+	verify(mpscq_empty(&stress_q));
+	verify(NULL == mpscq_extract(&stress_q));
+}
+#endif
+
+int main()
+{
+	test_basic();
+#ifdef HAVE_PTHREAD_H
+	test_threads();
+#endif
+
+	return 0;
+}
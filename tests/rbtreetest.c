@@ -0,0 +1,210 @@
+/*
+ * rbtreetest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+typedef struct {
+	unsigned int expiry;
+	rbtree_node_t node;
+} timeout_t;
+
+RBTREE_DECLARE_INLINE_WRAPPERS(timer_tree, timeout_t, node, unsigned int,
+			       expiry, RBTREE_SCALAR_COMPARE)
+
+typedef struct {
+	rbtree_node_t node;
+	const char *name;
+	int value;
+} symbol_t;
+
+RBTREE_DECLARE_INLINE_WRAPPERS(symtab, symbol_t, node, const char *, name,
+			       strcmp)
+
+/*
+ * Check the red-black and binary search tree properties, returning the
+ * black height of the tree.
+ */
+static int check_subtree(bintree_node_t *tree, long lo, long hi,
+			 int *count)
+{
+	if (!tree)
+		return 1;
+
+	rbtree_node_t *n = rbtree_from_bintree(tree);
+	timeout_t *t = timer_tree_from_rbtree(n);
+
+	verify(lo <= t->expiry && t->expiry <= hi);
+	if (n->red) {
+		verify(!tree->left || !rbtree_from_bintree(tree->left)->red);
+		verify(!tree->right || !rbtree_from_bintree(tree->right)->red);
+	}
+
+	int left = check_subtree(tree->left, lo, (long) t->expiry - 1, count);
+	int right = check_subtree(tree->right, (long) t->expiry + 1, hi, count);
+	verify(left == right);
+
+	(*count)++;
+	return left + !n->red;
+}
+
+static int check_tree(rbtree_t *tree)
+{
+	int count = 0;
+
+	verify(!tree->root || !rbtree_from_bintree(tree->root)->red);
+	(void) check_subtree(tree->root, 0, UINT32_MAX, &count);
+	return count;
+}
+
+static void test_basic()
+{
+	rbtree_t tree = RBTREE_VAR_INIT;
+	timeout_t t[8];
+
+	verify(rbtree_empty(&tree));
+	verify(NULL == timer_tree_first(&tree));
+	verify(NULL == timer_tree_find(&tree, 10));
+	verify(NULL == timer_tree_remove(&tree, 10));
+
+	/* ascending insertion would degenerate an unbalanced tree */
+	for (int i=0; i<lengthof(t); i++) {
+		memset(&t[i], 0, sizeof(t[i]));
+		t[i].expiry = 10 * (i + 1);
+		verify(NULL == timer_tree_insert(&tree, &t[i]));
+		verify(i + 1 == check_tree(&tree));
+	}
+
+	/* duplicate keys are refused */
+	timeout_t dup = { .expiry = 30 };
+	verify(&t[2] == timer_tree_insert(&tree, &dup));
+	verify(lengthof(t) == check_tree(&tree));
+
+	verify(&t[0] == timer_tree_first(&tree));
+	verify(&t[7] == timer_tree_last(&tree));
+	verify(&t[3] == timer_tree_find(&tree, 40));
+	verify(NULL == timer_tree_find(&tree, 45));
+
+	verify(&t[3] == timer_tree_lower_bound(&tree, 40));
+	verify(&t[4] == timer_tree_lower_bound(&tree, 41));
+	verify(&t[0] == timer_tree_lower_bound(&tree, 0));
+	verify(NULL == timer_tree_lower_bound(&tree, 81));
+	verify(&t[4] == timer_tree_upper_bound(&tree, 40));
+	verify(NULL == timer_tree_upper_bound(&tree, 80));
+
+	/* in-order iteration using both search and the bintree iterator */
+	int i = 0;
+	for (timeout_t *p = timer_tree_first(&tree); p;
+	     p = timer_tree_next(&tree, p))
+		verify(p == &t[i++]);
+	verify(i == lengthof(t));
+
+	bintree_iterator_t iter;
+	bintree_node_t *stack[RBTREE_MAX_DEPTH];
+	i = 0;
+	for (bintree_node_t *n = bintree_iterate_in_order_stack(
+		 &iter, tree.root, stack, lengthof(stack));
+	     n; n = bintree_next(&iter))
+		verify(timer_tree_from_rbtree(rbtree_from_bintree(n)) ==
+		       &t[i++]);
+	verify(i == lengthof(t));
+
+	/* remove the root, a leaf and then everything else */
+	unsigned int root =
+	    timer_tree_from_rbtree(rbtree_from_bintree(tree.root))->expiry;
+	verify(root == timer_tree_remove(&tree, root)->expiry);
+	verify(lengthof(t) - 1 == check_tree(&tree));
+	verify(&t[7] == timer_tree_remove(&tree, 80));
+	verify(bintree_is_leaf(&t[7].node.bintree));
+	verify(lengthof(t) - 2 == check_tree(&tree));
+	while (!rbtree_empty(&tree))
+		verify(timer_tree_remove(&tree, timer_tree_first(&tree)->expiry));
+}
+
+static void test_random()
+{
+	static timeout_t t[512];
+	static bool present[lengthof(t)];
+	rbtree_t tree = RBTREE_VAR_INIT;
+	uint32_t seed = RAND31_VAR_INIT;
+	int count = 0;
+
+	for (int i=0; i<lengthof(t); i++)
+		t[i].expiry = i;
+
+	for (int loop=0; loop<20000; loop++) {
+		unsigned int k = rand31_r(&seed) % lengthof(t);
+
+		if (present[k]) {
+			verify(&t[k] == timer_tree_remove(&tree, k));
+			verify(NULL == timer_tree_find(&tree, k));
+			count--;
+		} else {
+			verify(NULL == timer_tree_insert(&tree, &t[k]));
+			verify(&t[k] == timer_tree_find(&tree, k));
+			count++;
+		}
+		present[k] = !present[k];
+
+		if (loop % 64 == 0) {
+			verify(count == check_tree(&tree));
+
+			timeout_t *lb = timer_tree_lower_bound(&tree, k);
+			unsigned int expected = k;
+			while (expected < lengthof(t) && !present[expected])
+				expected++;
+			verify(lb ? lb == &t[expected] : expected == lengthof(t));
+		}
+	}
+
+	verify(count == check_tree(&tree));
+}
+
+static void test_strings()
+{
+	static const char *names[] = { "main", "fibre_run", "list_insert",
+				       "rbtree_insert", "abort", "zero" };
+	symbol_t sym[lengthof(names)];
+	rbtree_t tree = RBTREE_VAR_INIT;
+
+	for (int i=0; i<lengthof(sym); i++) {
+		memset(&sym[i], 0, sizeof(sym[i]));
+		sym[i].name = names[i];
+		sym[i].value = i;
+		verify(NULL == symtab_insert(&tree, &sym[i]));
+	}
+
+	verify(3 == symtab_find(&tree, "rbtree_insert")->value);
+	verify(NULL == symtab_find(&tree, "rbtree"));
+	verify(3 == symtab_lower_bound(&tree, "rbtree")->value);
+	verify(4 == symtab_first(&tree)->value);
+	verify(5 == symtab_last(&tree)->value);
+	verify(1 == symtab_next(&tree, &sym[4])->value);
+	verify(&sym[0] == symtab_remove(&tree, "main"));
+	verify(NULL == symtab_find(&tree, "main"));
+}
+
+int main()
+{
+	test_basic();
+	test_random();
+	test_strings();
+
+	return 0;
+}
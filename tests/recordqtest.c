@@ -0,0 +1,123 @@
+/*
+ * recordqtest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+static bool send(recordq_t *q, const char *msg)
+{
+	char *p = recordq_reserve(q, strlen(msg));
+	if (!p)
+		return false;
+
+	memcpy(p, msg, strlen(msg));
+	recordq_commit(q, p, strlen(msg));
+	return true;
+}
+
+static bool receive(recordq_t *q, const char *msg)
+{
+	size_t len;
+	char *p = recordq_peek(q, &len);
+	if (!p || len != strlen(msg) || 0 != memcmp(p, msg, len))
+		return false;
+
+	recordq_release(q, p);
+	return true;
+}
+
+static void test_basic()
+{
+	static uint32_t buf[8];
+	recordq_t q = RECORDQ_VAR_INIT(buf, sizeof(buf));
+	recordq_t myq;
+	size_t len;
+
+	/* prove the equivalence of the initializer and the init fn */
+	recordq_init(&myq, buf, sizeof(buf));
+	verify(0 == memcmp(&q, &myq, sizeof(q)));
+
+	verify(recordq_empty(&q));
+	verify(NULL == recordq_peek(&q, &len));
+
+	/* records of different lengths */
+	verify(send(&q, "a"));
+	verify(send(&q, "hello"));
+	verify(send(&q, "wor"));
+	verify(!recordq_empty(&q));
+	verify(receive(&q, "a"));
+	verify(receive(&q, "hello"));
+	verify(receive(&q, "wor"));
+	verify(recordq_empty(&q));
+
+	/* records that are too big for the queue */
+	verify(NULL == recordq_reserve(&q, sizeof(buf)));
+	verify(NULL == recordq_reserve(&q, sizeof(buf) - 4));
+
+	/* a reservation can be shrunk or abandoned */
+	char *p = recordq_reserve(&q, 12);
+	verify(p);
+	recordq_commit(&q, p, 0);
+	verify(recordq_empty(&q));
+	p = recordq_reserve(&q, 12);
+	memcpy(p, "xy", 2);
+	recordq_commit(&q, p, 2);
+	verify(receive(&q, "xy"));
+	verify(recordq_empty(&q));
+}
+
+static void test_wrap()
+{
+	static uint32_t buf[8];
+	recordq_t q = RECORDQ_VAR_INIT(buf, sizeof(buf));
+
+	/* fill the queue (the read pointer can never be caught up) */
+	verify(send(&q, "0123456789a"));
+	verify(send(&q, "0123456"));
+	verify(!send(&q, "0123456"));
+	verify(!send(&q, "1"));
+
+	/* a record that does not fit at the end moves to the start */
+	verify(receive(&q, "0123456789a"));
+	verify(send(&q, "abcdefg"));
+	verify(!send(&q, "a"));
+	verify(receive(&q, "0123456"));
+	verify(receive(&q, "abcdefg"));
+	verify(recordq_empty(&q));
+
+	/* soak test with many different lengths */
+	const char *msgs[] = { "1", "12345", "123456789", "12", "1234" };
+	int sent = 0, received = 0;
+	for (int i=0; i<1000; i++) {
+		while (send(&q, msgs[sent % lengthof(msgs)]))
+			sent++;
+		verify(receive(&q, msgs[received++ % lengthof(msgs)]));
+	}
+	while (received < sent)
+		verify(receive(&q, msgs[received++ % lengthof(msgs)]));
+	verify(recordq_empty(&q));
+}
+
+int main()
+{
+	test_basic();
+	test_wrap();
+
+	return 0;
+}
@@ -76,6 +76,48 @@ void *consumer(void *p)
 	}
 }
 
+static void test_bulk()
+{
+	uint8_t buf[8];
+	ringbuf_t rb = RINGBUF_VAR_INIT(buf, sizeof(buf));
+	uint8_t out[16];
+	size_t n;
+
+	/* writes are truncated when the ring is full */
+	verify(5 == ringbuf_write(&rb, "abcde", 5));
+	verify(2 == ringbuf_write(&rb, "fghij", 5));
+	verify(0 == ringbuf_write(&rb, "x", 1));
+
+	/* reads are truncated when the ring is empty */
+	verify(3 == ringbuf_read(&rb, out, 3));
+	verify(0 == memcmp(out, "abc", 3));
+
+	/* a write that wraps round the end of the buffer */
+	verify(3 == ringbuf_write(&rb, "klm", 3));
+	verify('d' == ringbuf_get(&rb));
+	verify(ringbuf_put(&rb, 'n'));
+
+	/* the contiguous block stops at the end of the buffer */
+	uint8_t *p = ringbuf_peek_contig(&rb, &n);
+	verify(p == buf+4 && 4 == n && 0 == memcmp(p, "efgk", 4));
+	ringbuf_consume(&rb, 2);
+	p = ringbuf_peek_contig(&rb, &n);
+	verify(p == buf+6 && 2 == n && 0 == memcmp(p, "gk", 2));
+	ringbuf_consume(&rb, 2);
+	p = ringbuf_peek_contig(&rb, &n);
+	verify(p == buf && 3 == n && 0 == memcmp(p, "lmn", 3));
+
+	/* a read that wraps round the end of the buffer */
+	ringbuf_consume(&rb, 2);
+	verify(5 == ringbuf_write(&rb, "opqrs", 5));
+	verify(ringbuf_put(&rb, 't'));
+	verify(7 == ringbuf_read(&rb, out, sizeof(out)));
+	verify(0 == memcmp(out, "nopqrst", 7));
+	p = ringbuf_peek_contig(&rb, &n);
+	verify(0 == n && ringbuf_empty(&rb));
+	verify(0 == ringbuf_read(&rb, out, sizeof(out)));
+}
+
 int main()
 {
 	ringbuf_t myring;
@@ -133,6 +175,8 @@ int main()
 		verify(i == ringbuf_get(&smallring));
 	}
 
+	test_bulk();
+
 	/* producer/consumer soak test (pretty pointless on strongly ordered
 	 * x86 but even on ARM/MIPS the runtime is pretty short)
 	 */
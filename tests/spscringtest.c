@@ -0,0 +1,143 @@
+/*
+ * spscringtest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+#define SOAK_LEN 10000000
+
+static void test_basic()
+{
+	uint8_t buf[4];
+	spscring_t rb = SPSCRING_VAR_INIT(buf, sizeof(buf));
+	spscring_t myrb;
+	uint8_t out[8];
+
+	/* prove the equivalence of the initializer and the init fn */
+	spscring_init(&myrb, buf, sizeof(buf));
+	verify(rb.bufp == myrb.bufp && rb.mask == myrb.mask);
+
+	/* the indices must not share a cache line */
+	verify(offsetof(spscring_t, readi) - offsetof(spscring_t, writei) >=
+	       CONFIG_CACHE_LINE_SIZE);
+
+	verify(-1 == spscring_get(&rb) && spscring_empty(&rb));
+
+	/* every byte of the buffer can be used */
+	for (int i=0; i<4; i++)
+		verify(spscring_put(&rb, i));
+	verify(!spscring_put(&rb, 4));
+
+	/* get/put/still full for all possible indices */
+	for (int i=0; i<8; i++) {
+		verify(i == spscring_get(&rb));
+		verify(spscring_put(&rb, i + 4));
+		verify(!spscring_put(&rb, 0));
+	}
+
+	/* correct sign handling for all data */
+	for (int i=8; i<12; i++)
+		verify(i == spscring_get(&rb));
+	verify(spscring_empty(&rb));
+	for (int i=0; i<0x100; i++) {
+		verify(spscring_put(&rb, i));
+		verify(i == spscring_get(&rb));
+	}
+
+	/* block copies that wrap round the end of the buffer */
+	verify(3 == spscring_write(&rb, "abc", 3));
+	verify(1 == spscring_write(&rb, "defg", 4));
+	verify(2 == spscring_read(&rb, out, 2));
+	verify(0 == memcmp(out, "ab", 2));
+	verify(2 == spscring_write(&rb, "efgh", 4));
+	verify(4 == spscring_read(&rb, out, sizeof(out)));
+	verify(0 == memcmp(out, "cdef", 4));
+	verify(0 == spscring_read(&rb, out, sizeof(out)));
+
+	/* free running indices wrap correctly */
+	atomic_store(&rb.writei, 0xfffffffe);
+	atomic_store(&rb.readi, 0xfffffffe);
+	rb.cached_writei = rb.cached_readi = 0xfffffffe;
+	verify(4 == spscring_write(&rb, "ijklm", 5));
+	verify(!spscring_put(&rb, 0));
+	verify('i' == spscring_get(&rb));
+	verify(3 == spscring_read(&rb, out, sizeof(out)));
+	verify(0 == memcmp(out, "jkl", 3));
+	verify(spscring_empty(&rb));
+}
+
+static uint8_t soakbuf[1024];
+static spscring_t soakring = SPSCRING_VAR_INIT(soakbuf, sizeof(soakbuf));
+
+static void *producer(void *p)
+{
+	uint8_t block[37];
+	uint8_t d = 0;
+
+	for (int sent=0; sent<SOAK_LEN; ) {
+		size_t n = lengthof(block);
+		if (n > SOAK_LEN - sent)
+			n = SOAK_LEN - sent;
+		for (int i=0; i<n; i++)
+			block[i] = d + i;
+
+		/* mix single byte and block operations */
+		if (sent & 1) {
+			while (!spscring_put(&soakring, block[0]))
+				;
+			n = 1;
+		} else {
+			n = spscring_write(&soakring, block, n);
+		}
+
+		d += n;
+		sent += n;
+	}
+
+	return p;
+}
+
+static void test_threads()
+{
+	pthread_t pt;
+	uint8_t block[53];
+	uint8_t d = 0;
+
+	verify(0 == pthread_create(&pt, NULL, producer, NULL));
+
+	for (int received=0; received<SOAK_LEN; ) {
+		size_t n = spscring_read(&soakring, block, lengthof(block));
+		for (int i=0; i<n; i++)
+			verify(block[i] == (uint8_t) (d + i));
+		d += n;
+		received += n;
+	}
+
+	verify(0 == pthread_join(pt, NULL));
+	verify(spscring_empty(&soakring));
+}
+
+int main()
+{
+	test_basic();
+	test_threads();
+
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * stackfibretest.c
+ *
+ * Part of librfn (a general utility library from redfelineninja.org.uk)
+ *
+ * Copyright (C) 2026 Daniel Thompson <daniel@redfelineninja.org.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <librfn.h>
+
+static char trace[64];
+static int tracep;
+
+static void record(char c)
+{
+	assert(tracep < (int) sizeof(trace) - 1);
+	trace[tracep++] = c;
+}
+
+/* yield from deep within the call chain with locals that must survive */
+static int recurse(char id, int depth)
+{
+	int local = depth;
+
+	if (depth) {
+		int sum = recurse(id, depth - 1);
+		stackfibre_yield();
+		return sum + local;
+	}
+
+	record(id);
+	return 0;
+}
+
+static void worker(void *arg)
+{
+	char id = *(char *) arg;
+	int sum = recurse(id, 3);
+
+	verify(6 == sum);
+	record(id);
+}
+
+static void test_yield()
+{
+	static char ids[] = "ab";
+	static stackfibre_t sf[2] = {
+		STACKFIBRE_VAR_INIT(worker, ids+0),
+		STACKFIBRE_VAR_INIT(worker, ids+1)
+	};
+
+	tracep = 0;
+	fibre_run(&sf[0].fibre);
+	fibre_run(&sf[1].fibre);
+
+	/* both fibres recurse and then yield three times before exiting */
+	for (int i=0; i<7; i++)
+		verify(0 == fibre_scheduler_next(0));
+	verify(FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(0));
+	trace[tracep] = '\0';
+	verify(0 == strcmp(trace, "abab"));
+
+	/* stacks are only held whilst a fibre is running */
+	verify(NULL == sf[0].stack && NULL == sf[1].stack);
+
+	/* fibres can be run again after they exit */
+	tracep = 0;
+	fibre_run(&sf[0].fibre);
+	for (int i=0; i<3; i++)
+		verify(0 == fibre_scheduler_next(0));
+	verify(FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(0));
+	trace[tracep] = '\0';
+	verify(0 == strcmp(trace, "aa"));
+}
+
+static void sleeper(void *arg)
+{
+	uint32_t *time = arg;
+
+	for (int i=0; i<3; i++) {
+		*time += 10;
+		stackfibre_sleep(*time);
+	}
+}
+
+static void waiter(void *arg)
+{
+	bool *flag = arg;
+
+	STACKFIBRE_WAIT_UNTIL(*flag);
+	*flag = false;
+}
+
+static void test_wait()
+{
+	static uint32_t time = 100;
+	static bool flag;
+	static stackfibre_t sf[2];
+
+	stackfibre_init(&sf[0], sleeper, &time);
+	stackfibre_init(&sf[1], waiter, &flag);
+	fibre_run(&sf[0].fibre);
+	fibre_run(&sf[1].fibre);
+
+	verify(100 == fibre_scheduler_next(100));
+	verify(110 == fibre_scheduler_next(100));
+	verify(120 == fibre_scheduler_next(110));
+	verify(120 == time);
+
+	/* the waiter does not run until it is woken */
+	flag = true;
+	fibre_run(&sf[1].fibre);
+	verify(120 == fibre_scheduler_next(115));
+	verify(false == flag && NULL == sf[1].stack);
+
+	verify(130 == fibre_scheduler_next(120));
+	verify(130+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(130));
+	verify(130 == time && NULL == sf[0].stack);
+}
+
+static void napper(void *arg)
+{
+	int *naps = arg;
+
+	stackfibre_sleep(300);
+	(*naps)++;
+}
+
+static void test_kill()
+{
+	static int naps;
+	static stackfibre_t sf[2];
+
+	stackfibre_init(&sf[0], napper, &naps);
+	stackfibre_init(&sf[1], napper, &naps);
+	fibre_run(&sf[0].fibre);
+	verify(300 == fibre_scheduler_next(200));
+	struct stackfibre_stack *stack = sf[0].stack;
+	verify(stack);
+
+	/* killing a suspended fibre returns its stack to the pool */
+	verify(fibre_kill(&sf[0].fibre));
+	verify(NULL == sf[0].stack);
+	fibre_run(&sf[1].fibre);
+	verify(300 == fibre_scheduler_next(200));
+	verify(stack == sf[1].stack);
+
+	/* a killed fibre restarts from its entry point */
+	fibre_run(&sf[0].fibre);
+	verify(300 == fibre_scheduler_next(200));
+	verify(sf[0].stack && stack != sf[0].stack);
+	verify(300 == fibre_scheduler_next(300));
+	verify(300+FIBRE_UNBOUNDED_SLEEP == fibre_scheduler_next(300));
+	verify(2 == naps);
+	verify(NULL == sf[0].stack && NULL == sf[1].stack);
+}
+
+int main()
+{
+	test_yield();
+	test_wait();
+	test_kill();
+
+	return 0;
+}